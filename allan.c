@@ -0,0 +1,174 @@
+/*
+ * This file is part of mpu6050.
+ *
+ * Copyright (C) 2025 William Clark
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+
+/*
+
+Online non-overlapping Allan variance at octave spaced cluster times.
+
+Level 0 holds clusters of one sample, and every two consecutive clusters
+of level k are averaged into one cluster of level k+1. Each level only
+keeps a half built cluster, the previous cluster and the running sum of
+squared differences, so memory is O(log N) and level k is touched once
+every 2^k samples, O(1) amortized per sample.
+
+    avar(tau) = sum (y[i+1] - y[i])^2 / (2 (M - 1))
+
+*/
+
+#include <stddef.h>
+#include <string.h>
+#include <math.h>
+#include <assert.h>
+
+#include "allan.h"
+
+#define G 9.80665
+
+static void push_axis(struct allan_level *level, double v);
+static void summarise(const struct allan_point *curve, uint32_t points, struct allan_axis *dst);
+
+int allan_init(allan_t *allan, double rate, uint64_t interval) {
+    assert(allan);
+
+    if (rate <= 0) {
+        return 1;
+    }
+
+    memset(allan, 0, sizeof *allan);
+    allan->tau0 = 1.0 / rate;
+    allan->interval = interval;
+
+    return 0;
+}
+
+/* add one sample, returns 1 if a snapshot was written to dst */
+uint32_t allan_push(allan_t *allan, const struct mpu6050_data *data, struct allan_snapshot *dst) {
+    assert(allan);
+    assert(data);
+
+    /* acc in m/s^2, gyro in deg/s */
+    push_axis(allan->level[ALLAN_ACC_X], data->acc.x * G / 1000.0);
+    push_axis(allan->level[ALLAN_ACC_Y], data->acc.y * G / 1000.0);
+    push_axis(allan->level[ALLAN_ACC_Z], data->acc.z * G / 1000.0);
+    push_axis(allan->level[ALLAN_GYRO_X], data->gyro.x / 10.0);
+    push_axis(allan->level[ALLAN_GYRO_Y], data->gyro.y / 10.0);
+    push_axis(allan->level[ALLAN_GYRO_Z], data->gyro.z / 10.0);
+
+    allan->samples++;
+
+    if (!allan->interval || allan->samples % allan->interval) {
+        return 0;
+    }
+
+    allan_snapshot(allan, dst);
+
+    return 1;
+}
+
+void allan_snapshot(const allan_t *allan, struct allan_snapshot *dst) {
+    const struct allan_level *l;
+    struct allan_point *p;
+    uint32_t a, k;
+
+    assert(allan);
+    assert(dst);
+
+    dst->samples = allan->samples;
+    dst->points = 0;
+
+    for (a=0; a<ALLAN_AXES; a++) {
+        for (k=0; k<ALLAN_LEVELS; k++) {
+            l = &allan->level[a][k];
+            if (!l->count) {
+                break;
+            }
+
+            p = &dst->curve[a][k];
+            p->tau = allan->tau0 * ((uint32_t)1 << k);
+            p->adev = sqrt(l->sum / (2.0 * l->count));
+            p->count = l->count;
+        }
+
+        /* every axis sees the same samples, so the same levels are valid */
+        dst->points = k;
+        summarise(dst->curve[a], k, &dst->axis[a]);
+    }
+
+    for (a=0; a<ALLAN_GYRO_X; a++) {
+        dst->axis[a].bias = dst->axis[a].bias / G * 1000.0;
+    }
+    for (; a<ALLAN_AXES; a++) {
+        dst->axis[a].bias *= 3600.0;
+    }
+}
+
+static void push_axis(struct allan_level *level, double v) {
+    struct allan_level *l;
+    uint32_t k;
+    double d;
+
+    for (k=0; k<ALLAN_LEVELS; k++) {
+        l = &level[k];
+
+        if (l->has_prev) {
+            d = v - l->prev;
+            l->sum += d * d;
+            l->count++;
+        }
+        l->prev = v;
+        l->has_prev = 1;
+
+        if (!l->has_half) {
+            l->half = v;
+            l->has_half = 1;
+            return;
+        }
+
+        /* two clusters of this level make one of the next */
+        v = (l->half + v) / 2;
+        l->has_half = 0;
+    }
+}
+
+/* random walk: of the adjacent pairs of points, take the one whose slope */
+/* is closest to -1/2 and extend a -1/2 line through its second point to */
+/* tau = 1 s, adev * sqrt(tau). bias instability: the flat bottom of the */
+/* curve divided by sqrt(2 ln 2 / pi) = 0.664 */
+static void summarise(const struct allan_point *curve, uint32_t points, struct allan_axis *dst) {
+    double slope, best = 1e9;
+    uint32_t k;
+
+    memset(dst, 0, sizeof *dst);
+
+    for (k=0; k<points && curve[k].count >= ALLAN_MIN_CLUSTERS; k++) {
+        if (k && curve[k].adev > 0 && curve[k-1].adev > 0) {
+            slope = log(curve[k].adev / curve[k-1].adev) / log(curve[k].tau / curve[k-1].tau);
+            if (fabs(slope + 0.5) < best) {
+                best = fabs(slope + 0.5);
+                dst->random_walk = curve[k].adev * sqrt(curve[k].tau) * 60.0;
+            }
+        }
+
+        if (!k || curve[k].adev < dst->bias * 0.664) {
+            dst->bias = curve[k].adev / 0.664;
+            dst->tau_bias = curve[k].tau;
+        }
+    }
+}
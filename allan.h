@@ -0,0 +1,83 @@
+/*
+ * This file is part of mpu6050.
+ *
+ * Copyright (C) 2025 William Clark
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+
+#ifndef ALLAN_H
+#define ALLAN_H
+
+#include <stdint.h>
+#include "mpu6050.h"
+
+#define ALLAN_LEVELS       32 /* cluster times tau0 * 2^k, k < ALLAN_LEVELS */
+#define ALLAN_MIN_CLUSTERS 8 /* fewest cluster differences used for the summary */
+
+/* axes taken from struct mpu6050_data */
+#define ALLAN_ACC_X  0
+#define ALLAN_ACC_Y  1
+#define ALLAN_ACC_Z  2
+#define ALLAN_GYRO_X 3
+#define ALLAN_GYRO_Y 4
+#define ALLAN_GYRO_Z 5
+#define ALLAN_AXES   6
+
+/* state of one cluster time on one axis */
+struct allan_level {
+    double half; /* average of the first half of the cluster being built */
+    double prev; /* average of the last complete cluster */
+    double sum; /* of squared differences between consecutive clusters */
+    uint32_t count; /* differences in sum */
+    uint8_t has_half;
+    uint8_t has_prev;
+};
+
+struct allan_point {
+    double tau; /* s */
+    double adev; /* m/s^2 for acc, deg/s for gyro */
+    uint32_t count;
+};
+
+/* acc: random walk in m/s/sqrt(h), bias instability in mg */
+/* gyro: random walk in deg/sqrt(h), bias instability in deg/h */
+struct allan_axis {
+    double random_walk;
+    double bias;
+    double tau_bias; /* s, where the curve bottoms out */
+};
+
+struct allan_snapshot {
+    uint64_t samples;
+    uint32_t points; /* valid entries in curve */
+    struct allan_point curve[ALLAN_AXES][ALLAN_LEVELS];
+    struct allan_axis axis[ALLAN_AXES];
+};
+
+struct allan {
+    double tau0; /* sample period, s */
+    uint64_t interval; /* samples between snapshots, 0 = none */
+    uint64_t samples;
+    struct allan_level level[ALLAN_AXES][ALLAN_LEVELS];
+};
+
+typedef struct allan allan_t;
+
+int allan_init(allan_t *allan, double rate, uint64_t interval);
+uint32_t allan_push(allan_t *allan, const struct mpu6050_data *data, struct allan_snapshot *dst);
+void allan_snapshot(const allan_t *allan, struct allan_snapshot *dst);
+
+#endif
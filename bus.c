@@ -0,0 +1,540 @@
+/*
+ * This file is part of mpu6050.
+ *
+ * Copyright (C) 2025 William Clark
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+
+/*
+
+Transaction scheduler for several devices sharing one I2C adapter.
+
+Every device may have a periodic burst read (e.g. 14 bytes from
+REG_ACCEL_XOUT_H of each MPU-6050 at 0x68 and 0x69) plus one-off reads
+and writes. All of them are queued by deadline, earliest first, and sent
+as combined I2C_RDWR transfers of up to BUS_MAX_MSGS messages, each with
+its own slave address, so no I2C_SLAVE switching is needed. A read
+continuing the register range of the read just before it on the same
+device is folded into that message, if the device was added with
+BUS_AUTO_INC. Registers such as FIFO_R_W do not auto-increment, so this
+is off by default.
+
+A periodic sample is released every 1/rate s and must be read before the
+next one replaces it, which is its deadline. Times are CLOCK_MONOTONIC ns,
+see bus_now().
+
+An mpu6050_t is put on the bus with bus_mpu6050_attach(), which points
+its dev.read and dev.write at trampolines that queue the access and run
+the bus until it is done, and bus_mpu6050_done() as the periodic callback
+decodes each burst into it.
+
+*/
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <linux/i2c.h>
+#include <linux/i2c-dev.h>
+#include <stdint.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#include <assert.h>
+
+#include "bus.h"
+
+static uint32_t read_bits(uint32_t len);
+static int enqueue(bus_t *bus, const struct bus_xact *x);
+static void release(bus_t *bus, uint64_t now);
+static int transfer(bus_t *bus, uint64_t *now);
+static int slot_read(uint32_t s, uint8_t reg, uint8_t *dst, uint32_t size);
+static int slot_write(uint32_t s, uint8_t reg, uint8_t value);
+
+/* mpu6050_dev callbacks carry no context, so every attached device */
+/* gets its own pair of trampolines bound to a slot */
+struct bus_slot {
+    bus_t *bus;
+    uint8_t id;
+};
+
+/* bus = NULL for a free slot */
+static struct bus_slot slot[BUS_MAX_DEVICES];
+
+#define BUS_SLOT(n) \
+    static int slot_read##n(uint8_t reg, uint8_t *dst, uint32_t size) { return slot_read(n, reg, dst, size); } \
+    static int slot_write##n(uint8_t reg, uint8_t value) { return slot_write(n, reg, value); }
+
+/* one per BUS_MAX_DEVICES */
+BUS_SLOT(0)
+BUS_SLOT(1)
+BUS_SLOT(2)
+BUS_SLOT(3)
+BUS_SLOT(4)
+BUS_SLOT(5)
+BUS_SLOT(6)
+BUS_SLOT(7)
+
+static int (*const slot_reads[BUS_MAX_DEVICES])(uint8_t reg, uint8_t *dst, uint32_t size) = {
+    slot_read0, slot_read1, slot_read2, slot_read3,
+    slot_read4, slot_read5, slot_read6, slot_read7
+};
+
+static int (*const slot_writes[BUS_MAX_DEVICES])(uint8_t reg, uint8_t value) = {
+    slot_write0, slot_write1, slot_write2, slot_write3,
+    slot_write4, slot_write5, slot_write6, slot_write7
+};
+
+int bus_init(bus_t *bus, const char *adapter, uint32_t hz) {
+    assert(bus);
+
+    if (hz == 0) {
+        fprintf(stderr, "bus_init(): invalid bus clock of 0 Hz\n");
+        return 1;
+    }
+
+    memset(bus, 0, sizeof *bus);
+    bus->hz = hz;
+    bus->fd = -1;
+
+    if (adapter == NULL) {
+        return 0;
+    }
+
+    bus->fd = open(adapter, O_RDWR);
+    if (bus->fd < 0) {
+        fprintf(stderr, "bus_init(): could not open device: %s\n", adapter);
+        return 1;
+    }
+
+    return 0;
+}
+
+int bus_deinit(bus_t *bus) {
+    uint32_t s;
+
+    assert(bus);
+
+    /* devices attached to this bus are left without read and write */
+    for (s=0; s<BUS_MAX_DEVICES; s++) {
+        if (slot[s].bus == bus) {
+            slot[s].bus = NULL;
+        }
+    }
+
+    if (bus->fd >= 0) {
+        close(bus->fd);
+        bus->fd = -1;
+    }
+
+    return 0;
+}
+
+/* register a device, rate = 0 disables periodic reads, flags is BUS_AUTO_INC or 0 */
+/* warns if the periodic reads of all devices no longer fit the bus */
+int bus_add(bus_t *bus, uint16_t addr, uint8_t flags, uint32_t rate, uint8_t reg, uint8_t len,
+    void (*done)(void *ctx, const uint8_t *data, uint32_t len), void *ctx, uint8_t *id) {
+    struct bus_device *dev;
+    double load;
+
+    assert(bus);
+    assert(id);
+
+    if (bus->devices == BUS_MAX_DEVICES || len > BUS_MAX_BURST || (rate && !len)) {
+        fprintf(stderr, "bus_add(): cannot add device 0x%02x\n", addr);
+        return 1;
+    }
+
+    dev = &bus->dev[bus->devices];
+    memset(dev, 0, sizeof *dev);
+    dev->addr = addr;
+    dev->reg = reg;
+    dev->len = len;
+    dev->flags = flags;
+    dev->period = rate ? 1000000000ul / rate : 0;
+    dev->done = done;
+    dev->ctx = ctx;
+
+    *id = bus->devices++;
+
+    load = bus_load(bus);
+    if (load > BUS_LOAD_MAX) {
+        fprintf(stderr, "bus_add(): sample rates need %.0f%% of the %lu Hz bus, at most %.0f%% is usable\n",
+            load * 100, (unsigned long)bus->hz, BUS_LOAD_MAX * 100);
+    }
+
+    return 0;
+}
+
+int bus_queue_read(bus_t *bus, uint8_t id, uint8_t reg, uint8_t *dst, uint32_t len, uint64_t deadline) {
+    struct bus_xact x;
+
+    assert(bus);
+    assert(dst);
+
+    if (id >= bus->devices || len == 0 || len > BUS_SCRATCH) {
+        return 1;
+    }
+
+    memset(&x, 0, sizeof x);
+    x.deadline = deadline;
+    x.dst = dst;
+    x.len = len;
+    x.dev = id;
+    x.out[0] = reg;
+
+    return enqueue(bus, &x);
+}
+
+int bus_queue_write(bus_t *bus, uint8_t id, uint8_t reg, uint8_t value, uint64_t deadline) {
+    struct bus_xact x;
+
+    assert(bus);
+
+    if (id >= bus->devices) {
+        return 1;
+    }
+
+    memset(&x, 0, sizeof x);
+    x.deadline = deadline;
+    x.dev = id;
+    x.out[0] = reg;
+    x.out[1] = value;
+
+    return enqueue(bus, &x);
+}
+
+/* queue periodic reads that are due and send everything queued */
+/* on error whatever is still queued is dropped, so no read destination */
+/* outlives the call */
+int bus_run(bus_t *bus, uint64_t now) {
+    uint32_t i;
+    int err = 0;
+
+    assert(bus);
+
+    if (!bus->started) {
+        bus->start = now;
+        bus->started = 1;
+    }
+
+    release(bus, now);
+
+    while (bus->queued && !err) {
+        err |= transfer(bus, &now);
+    }
+
+    for (i=0; i<bus->queued; i++) {
+        if (bus->queue[i].periodic) {
+            bus->dev[bus->queue[i].dev].pending = 0;
+        }
+    }
+    bus->stats.dropped += bus->queued;
+    bus->queued = 0;
+
+    return err;
+}
+
+/* expected share of the bus taken by periodic reads */
+double bus_load(const bus_t *bus) {
+    double bits = 0;
+    uint32_t i;
+
+    assert(bus);
+
+    for (i=0; i<bus->devices; i++) {
+        if (bus->dev[i].period) {
+            bits += read_bits(bus->dev[i].len) * 1e9 / bus->dev[i].period;
+        }
+    }
+
+    return bits / bus->hz;
+}
+
+/* measured share of the bus used since the first bus_run() */
+double bus_utilization(const bus_t *bus, uint64_t now) {
+    assert(bus);
+
+    if (!bus->started || now <= bus->start) {
+        return 0;
+    }
+
+    return bus->stats.bits * 1e9 / ((double)bus->hz * (now - bus->start));
+}
+
+/* CLOCK_MONOTONIC in ns, the time base of bus_run() and deadlines */
+uint64_t bus_now(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t)ts.tv_sec * 1000000000ul + ts.tv_nsec;
+}
+
+/* periodic callback for a 14 byte burst from REG_ACCEL_XOUT_H, ctx is the mpu6050_t */
+void bus_mpu6050_done(void *ctx, const uint8_t *data, uint32_t len) {
+    assert(ctx);
+    assert(data);
+
+    if (len < 14) {
+        return;
+    }
+
+    mpu6050_decode((mpu6050_t *)ctx, data);
+}
+
+/* route the register accesses of mpu6050 through device id of bus */
+/* only dev.read and dev.write are set, init, deinit and sleep are left alone */
+int bus_mpu6050_attach(bus_t *bus, uint8_t id, mpu6050_t *mpu6050) {
+    uint32_t s;
+
+    assert(bus);
+    assert(mpu6050);
+
+    if (id >= bus->devices) {
+        return 1;
+    }
+
+    /* reuse the slot of an earlier attach, else take a free one */
+    for (s=0; s<BUS_MAX_DEVICES && (slot[s].bus != bus || slot[s].id != id); s++)
+        ;
+
+    if (s == BUS_MAX_DEVICES) {
+        for (s=0; s<BUS_MAX_DEVICES && slot[s].bus != NULL; s++)
+            ;
+    }
+
+    if (s == BUS_MAX_DEVICES) {
+        fprintf(stderr, "bus_mpu6050_attach(): no free slot for 0x%02x\n", bus->dev[id].addr);
+        return 1;
+    }
+
+    slot[s].bus = bus;
+    slot[s].id = id;
+
+    mpu6050->dev.read = slot_reads[s];
+    mpu6050->dev.write = slot_writes[s];
+
+    return 0;
+}
+
+/* start, address, register, restart, address, data, stop; 9 bits per byte with ack */
+static uint32_t read_bits(uint32_t len) {
+    return 1 + 9 + 9 + 1 + 9 + 9 * len + 1;
+}
+
+static int enqueue(bus_t *bus, const struct bus_xact *x) {
+    uint32_t i;
+
+    if (bus->queued == BUS_MAX_QUEUE) {
+        fprintf(stderr, "bus: queue full, dropping transaction for 0x%02x\n", bus->dev[x->dev].addr);
+        return 1;
+    }
+
+    /* insert behind every transaction with the same or an earlier deadline */
+    for (i=bus->queued; i>0 && bus->queue[i-1].deadline > x->deadline; i--) {
+        bus->queue[i] = bus->queue[i-1];
+    }
+    bus->queue[i] = *x;
+    bus->queued++;
+
+    return 0;
+}
+
+static void release(bus_t *bus, uint64_t now) {
+    struct bus_device *dev;
+    struct bus_xact x;
+    uint32_t i;
+
+    for (i=0; i<bus->devices; i++) {
+        dev = &bus->dev[i];
+
+        if (dev->period && !dev->scheduled) {
+            dev->release = now;
+            dev->scheduled = 1;
+        }
+
+        if (!dev->period || dev->pending || dev->release > now) {
+            continue;
+        }
+
+        /* samples released while the previous read was still pending are lost */
+        while (dev->release + dev->period <= now) {
+            dev->release += dev->period;
+            bus->stats.overruns++;
+        }
+
+        memset(&x, 0, sizeof x);
+        x.deadline = dev->release + dev->period;
+        x.dst = dev->buf;
+        x.len = dev->len;
+        x.dev = i;
+        x.periodic = 1;
+        x.out[0] = dev->reg;
+
+        if (!enqueue(bus, &x)) {
+            dev->pending = 1;
+            dev->release += dev->period;
+        }
+    }
+}
+
+/* pack queued transactions, earliest deadline first, into one I2C_RDWR */
+/* now is advanced by the time the transfer occupies the bus */
+static int transfer(bus_t *bus, uint64_t *now) {
+    struct i2c_rdwr_ioctl_data rdwr;
+    struct i2c_msg *msg, *last_rd = NULL;
+    struct bus_xact *x;
+    uint32_t n = 0, used = 0, count, i;
+    uint8_t last_reg = 0;
+    uint64_t bits = 1; /* stop */
+    int err;
+
+    for (count=0; count<bus->queued; count++) {
+        x = &bus->queue[count];
+
+        if (!x->len) {
+            if (n + 1 > BUS_MAX_MSGS) {
+                break;
+            }
+            msg = &bus->msgs[n++];
+            msg->addr = bus->dev[x->dev].addr;
+            msg->flags = 0;
+            msg->len = 2;
+            msg->buf = x->out;
+            continue;
+        }
+
+        /* continues the register range of the previous read on this device */
+        if ((bus->dev[x->dev].flags & BUS_AUTO_INC)
+            && last_rd != NULL && last_rd == &bus->msgs[n-1]
+            && last_rd->addr == bus->dev[x->dev].addr
+            && x->out[0] >= last_reg && x->out[0] <= last_reg + last_rd->len) {
+            i = x->out[0] - last_reg + x->len; /* new length of the read */
+            if (i > last_rd->len) {
+                if (used + i - last_rd->len > BUS_SCRATCH) {
+                    break;
+                }
+                used += i - last_rd->len;
+                last_rd->len = i;
+            }
+            x->offset = (last_rd->buf - bus->scratch) + (x->out[0] - last_reg);
+            bus->stats.merged++;
+            continue;
+        }
+
+        if (n + 2 > BUS_MAX_MSGS || used + x->len > BUS_SCRATCH) {
+            break;
+        }
+
+        msg = &bus->msgs[n++];
+        msg->addr = bus->dev[x->dev].addr;
+        msg->flags = 0;
+        msg->len = 1;
+        msg->buf = x->out;
+
+        msg = &bus->msgs[n++];
+        msg->addr = bus->dev[x->dev].addr;
+        msg->flags = I2C_M_RD;
+        msg->len = x->len;
+        msg->buf = bus->scratch + used;
+
+        x->offset = used;
+        used += x->len;
+        last_rd = msg;
+        last_reg = x->out[0];
+    }
+
+    /* (re)start, address and data of every message */
+    for (i=0; i<n; i++) {
+        bits += 1 + 9 + 9 * bus->msgs[i].len;
+    }
+
+    if (bus->xfer != NULL) {
+        err = bus->xfer(bus->msgs, n);
+    } else {
+        rdwr.msgs = bus->msgs;
+        rdwr.nmsgs = n;
+        err = ioctl(bus->fd, I2C_RDWR, &rdwr) < 0;
+    }
+
+    if (err) {
+        fprintf(stderr, "bus: transfer of %lu messages failed\n", (unsigned long)n);
+    } else {
+        bus->stats.transfers++;
+        bus->stats.msgs += n;
+        bus->stats.bits += bits;
+    }
+
+    *now += bits * 1000000000ul / bus->hz;
+
+    for (i=0; i<count; i++) {
+        x = &bus->queue[i];
+
+        if (!err && x->len) {
+            memcpy(x->dst, bus->scratch + x->offset, x->len);
+        }
+
+        /* only periodic reads have a real deadline, one-off accesses are */
+        /* due at once and always finish after it */
+        if (x->periodic) {
+            if (*now > x->deadline) {
+                bus->stats.late++;
+            }
+
+            bus->dev[x->dev].pending = 0;
+            if (!err && bus->dev[x->dev].done != NULL) {
+                bus->dev[x->dev].done(bus->dev[x->dev].ctx, x->dst, x->len);
+            }
+        }
+    }
+
+    bus->stats.xacts += count;
+    bus->queued -= count;
+    memmove(bus->queue, bus->queue + count, bus->queued * sizeof *bus->queue);
+
+    return err;
+}
+
+/* queue the access ahead of anything not yet due and run the bus until it is done */
+static int slot_read(uint32_t s, uint8_t reg, uint8_t *dst, uint32_t size) {
+    uint64_t now = bus_now();
+
+    /* the bus has been deinitialised */
+    if (slot[s].bus == NULL) {
+        return 1;
+    }
+
+    if (bus_queue_read(slot[s].bus, slot[s].id, reg, dst, size, now)) {
+        return 1;
+    }
+
+    return bus_run(slot[s].bus, now);
+}
+
+static int slot_write(uint32_t s, uint8_t reg, uint8_t value) {
+    uint64_t now = bus_now();
+
+    if (slot[s].bus == NULL) {
+        return 1;
+    }
+
+    if (bus_queue_write(slot[s].bus, slot[s].id, reg, value, now)) {
+        return 1;
+    }
+
+    return bus_run(slot[s].bus, now);
+}
@@ -0,0 +1,110 @@
+/*
+ * This file is part of mpu6050.
+ *
+ * Copyright (C) 2025 William Clark
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+
+#ifndef BUS_H
+#define BUS_H
+
+#include <stdint.h>
+#include <linux/i2c.h>
+
+#include "mpu6050.h"
+
+#define BUS_STANDARD_HZ 100000
+#define BUS_FAST_HZ     400000
+
+#define BUS_MAX_DEVICES 8
+#define BUS_MAX_QUEUE   32
+#define BUS_MAX_MSGS    42 /* I2C_RDWR_IOCTL_MAX_MSGS */
+#define BUS_MAX_BURST   32 /* bytes read per periodic sample */
+#define BUS_SCRATCH     512 /* read bytes per combined transfer */
+#define BUS_LOAD_MAX    0.8 /* usable share of the bus, the rest is driver and clock stretch slack */
+
+/* bus_add() flags */
+#define BUS_AUTO_INC    0x01 /* register address auto-increments, adjacent reads may be merged */
+
+/* one queued register access */
+struct bus_xact {
+    uint64_t deadline; /* ns */
+    uint8_t *dst; /* read destination */
+    uint32_t len; /* bytes to read, 0 for a write */
+    uint32_t offset; /* into scratch once packed */
+    uint8_t dev;
+    uint8_t periodic;
+    uint8_t out[2]; /* register, value to write */
+};
+
+struct bus_device {
+    uint16_t addr;
+    uint8_t reg; /* periodic burst read */
+    uint8_t len;
+    uint8_t flags; /* BUS_AUTO_INC */
+    uint64_t period; /* ns, 0 = no periodic reads */
+    uint64_t release; /* next sample becomes available, ns */
+    uint8_t scheduled; /* release has been set by bus_run() */
+    uint8_t pending;
+    uint8_t buf[BUS_MAX_BURST];
+    /* called with each periodic burst, e.g. bus_mpu6050_done() for REG_ACCEL_XOUT_H */
+    void (*done)(void *ctx, const uint8_t *data, uint32_t len);
+    void *ctx;
+};
+
+struct bus_stats {
+    uint32_t transfers; /* combined I2C_RDWR transfers */
+    uint32_t msgs;
+    uint32_t xacts;
+    uint32_t merged; /* reads folded into the previous read */
+    uint32_t late; /* periodic reads completed after their deadline */
+    uint32_t dropped; /* left queued by a failed transfer */
+    uint32_t overruns; /* periodic samples never read */
+    uint64_t bits; /* clocked on the bus */
+};
+
+struct bus {
+    int fd;
+    uint32_t hz;
+    /* NULL = ioctl(I2C_RDWR) on fd */
+    int (*xfer)(struct i2c_msg *msgs, uint32_t n);
+    struct bus_device dev[BUS_MAX_DEVICES];
+    uint32_t devices;
+    struct bus_xact queue[BUS_MAX_QUEUE]; /* sorted by deadline */
+    uint32_t queued;
+    struct i2c_msg msgs[BUS_MAX_MSGS];
+    uint8_t scratch[BUS_SCRATCH];
+    uint64_t start; /* first bus_run(), ns */
+    uint8_t started;
+    struct bus_stats stats;
+};
+
+typedef struct bus bus_t;
+
+int bus_init(bus_t *bus, const char *adapter, uint32_t hz);
+int bus_deinit(bus_t *bus);
+int bus_add(bus_t *bus, uint16_t addr, uint8_t flags, uint32_t rate, uint8_t reg, uint8_t len,
+    void (*done)(void *ctx, const uint8_t *data, uint32_t len), void *ctx, uint8_t *id);
+int bus_queue_read(bus_t *bus, uint8_t id, uint8_t reg, uint8_t *dst, uint32_t len, uint64_t deadline);
+int bus_queue_write(bus_t *bus, uint8_t id, uint8_t reg, uint8_t value, uint64_t deadline);
+int bus_run(bus_t *bus, uint64_t now);
+double bus_load(const bus_t *bus);
+double bus_utilization(const bus_t *bus, uint64_t now);
+uint64_t bus_now(void);
+void bus_mpu6050_done(void *ctx, const uint8_t *data, uint32_t len);
+int bus_mpu6050_attach(bus_t *bus, uint8_t id, mpu6050_t *mpu6050);
+
+#endif
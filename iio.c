@@ -0,0 +1,359 @@
+/*
+ * This file is part of mpu6050.
+ *
+ * Copyright (C) 2025 William Clark
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+
+/*
+
+Buffered capture through the linux IIO subsystem, for boards where the
+kernel inv_mpu6050 driver is bound to the device. Scans are hardware
+triggered and timestamped by the kernel and read in bulk from the char
+device instead of polling registers over /dev/i2c-N.
+
+Both paths are taken from struct iio_config, so the sysfs directory may
+be a plain directory tree and the char device a pipe.
+
+*/
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdint.h>
+#include <assert.h>
+
+#include "iio.h"
+
+#define IIO_PATH_MAX 256
+#define G 9.80665
+#define PI 3.14159265358979323846
+
+static const char *channel_names[IIO_NUM_CHANNELS] = {
+    "accel_x", "accel_y", "accel_z", "temp",
+    "anglvel_x", "anglvel_y", "anglvel_z", "timestamp"
+};
+
+static int sysfs_write(iio_t *iio, const char *file, const char *value);
+static int sysfs_read(iio_t *iio, const char *file, char *dst, uint32_t size);
+static int sysfs_read_double(iio_t *iio, const char *file, double *dst);
+static int setup_channel(iio_t *iio, int n);
+static void compute_layout(iio_t *iio);
+static uint64_t extract(const struct iio_channel *ch, const uint8_t *scan);
+static void decode(iio_t *iio, const uint8_t *scan, struct mpu6050_sample *dst);
+
+int iio_init(iio_t *iio, const struct iio_config *cfg) {
+    char value[32];
+    double acc_scale = 0, gyro_scale = 0, temp_scale = 0;
+    int i;
+    int err = 0;
+
+    assert(iio);
+    assert(cfg);
+
+    memset(iio, 0, sizeof *iio);
+    iio->cfg = *cfg;
+    iio->fd = -1;
+
+    /* the buffer must be disabled while scan elements are changed */
+    err |= sysfs_write(iio, "buffer/enable", "0");
+
+    for (i=0; i<IIO_NUM_CHANNELS; i++) {
+        err |= setup_channel(iio, i);
+    }
+
+    if (cfg->freq) {
+        sprintf(value, "%lu", (unsigned long)cfg->freq);
+        err |= sysfs_write(iio, "sampling_frequency", value);
+    }
+
+    if (cfg->length) {
+        sprintf(value, "%lu", (unsigned long)cfg->length);
+        err |= sysfs_write(iio, "buffer/length", value);
+    }
+
+    /* accel in m/s^2, anglvel in rad/s and temp in milli deg C per lsb */
+    err |= sysfs_read_double(iio, "in_accel_scale", &acc_scale);
+    err |= sysfs_read_double(iio, "in_anglvel_scale", &gyro_scale);
+    err |= sysfs_read_double(iio, "in_temp_scale", &temp_scale);
+    err |= sysfs_read_double(iio, "in_temp_offset", &iio->temp_offset);
+
+    if (err) {
+        return 1;
+    }
+
+    iio->acc_mult = acc_scale / G * 1000.0;
+    iio->gyro_mult = gyro_scale * 180.0 / PI * 10.0;
+    iio->temp_mult = temp_scale / 100.0;
+
+    compute_layout(iio);
+
+    if (iio->scan_size > IIO_READ_SIZE) {
+        fprintf(stderr, "iio_init(): scan of %lu bytes does not fit buffer\n",
+            (unsigned long)iio->scan_size);
+        return 1;
+    }
+
+    if (sysfs_write(iio, "buffer/enable", "1")) {
+        return 1;
+    }
+
+    iio->fd = open(cfg->chrdev, O_RDONLY);
+    if (iio->fd < 0) {
+        fprintf(stderr, "iio_init(): could not open device: %s\n", cfg->chrdev);
+        sysfs_write(iio, "buffer/enable", "0");
+        return 1;
+    }
+
+    return 0;
+}
+
+int iio_deinit(iio_t *iio) {
+    assert(iio);
+
+    if (iio->fd >= 0) {
+        close(iio->fd);
+        iio->fd = -1;
+    }
+
+    return sysfs_write(iio, "buffer/enable", "0");
+}
+
+/* read one scan into mpu6050->data, same units as mpu6050_read() */
+int iio_read(iio_t *iio, mpu6050_t *mpu6050) {
+    struct mpu6050_sample sample;
+    uint32_t count;
+
+    assert(mpu6050);
+
+    do {
+        if (iio_read_batch(iio, &sample, 1, &count)) {
+            return 1;
+        }
+    } while (!count);
+
+    mpu6050->data = sample.data;
+
+    return 0;
+}
+
+/* decode up to max scans into dst, issuing at most one read() */
+/* the read asks for all free buffer space, scans beyond max and partial */
+/* scans are kept for the next call */
+int iio_read_batch(iio_t *iio, struct mpu6050_sample *dst, uint32_t max, uint32_t *count) {
+    uint32_t have, used, n;
+    int ret;
+
+    assert(iio);
+    assert(dst);
+    assert(count);
+
+    *count = 0;
+    have = iio->fill / iio->scan_size;
+
+    if (have < max) {
+        ret = read(iio->fd, iio->buf + iio->fill, IIO_READ_SIZE - iio->fill);
+        if (ret < 0 || (ret == 0 && !have)) {
+            fprintf(stderr, "iio_read_batch(): error read()\n");
+            return 1;
+        }
+
+        iio->fill += ret;
+        have = iio->fill / iio->scan_size;
+    }
+
+    n = have < max ? have : max;
+    for (used=0; *count<n; used+=iio->scan_size) {
+        decode(iio, iio->buf + used, &dst[(*count)++]);
+    }
+
+    iio->fill -= used;
+    memmove(iio->buf, iio->buf + used, iio->fill);
+
+    return 0;
+}
+
+static int sysfs_write(iio_t *iio, const char *file, const char *value) {
+    char path[IIO_PATH_MAX];
+    FILE *f;
+    int err = 0;
+
+    snprintf(path, sizeof path, "%s/%s", iio->cfg.sysfs, file);
+
+    f = fopen(path, "w");
+    if (f == NULL) {
+        fprintf(stderr, "iio: could not open %s\n", path);
+        return 1;
+    }
+
+    err |= fputs(value, f) < 0;
+    err |= fclose(f) != 0;
+
+    if (err) {
+        fprintf(stderr, "iio: could not write %s\n", path);
+    }
+
+    return err;
+}
+
+static int sysfs_read(iio_t *iio, const char *file, char *dst, uint32_t size) {
+    char path[IIO_PATH_MAX];
+    FILE *f;
+    char *ok;
+
+    snprintf(path, sizeof path, "%s/%s", iio->cfg.sysfs, file);
+
+    f = fopen(path, "r");
+    if (f == NULL) {
+        fprintf(stderr, "iio: could not open %s\n", path);
+        return 1;
+    }
+
+    ok = fgets(dst, size, f);
+    fclose(f);
+
+    if (ok == NULL) {
+        fprintf(stderr, "iio: could not read %s\n", path);
+        return 1;
+    }
+
+    return 0;
+}
+
+static int sysfs_read_double(iio_t *iio, const char *file, double *dst) {
+    char value[32];
+
+    if (sysfs_read(iio, file, value, sizeof value)) {
+        return 1;
+    }
+
+    *dst = atof(value);
+
+    return 0;
+}
+
+/* enable a scan element and parse its index and type, e.g. "be:s16/16>>0" */
+static int setup_channel(iio_t *iio, int n) {
+    char file[64];
+    char value[32];
+    char endian, sign;
+    unsigned int bits, storage, shift;
+    struct iio_channel *ch = &iio->ch[n];
+
+    sprintf(file, "scan_elements/in_%s_en", channel_names[n]);
+    if (sysfs_write(iio, file, "1")) {
+        return 1;
+    }
+
+    sprintf(file, "scan_elements/in_%s_index", channel_names[n]);
+    if (sysfs_read(iio, file, value, sizeof value)) {
+        return 1;
+    }
+    ch->index = atoi(value);
+
+    sprintf(file, "scan_elements/in_%s_type", channel_names[n]);
+    if (sysfs_read(iio, file, value, sizeof value)) {
+        return 1;
+    }
+
+    if (sscanf(value, "%ce:%c%u/%u>>%u", &endian, &sign, &bits, &storage, &shift) != 5
+        || (storage != 8 && storage != 16 && storage != 32 && storage != 64)
+        || bits == 0 || bits > storage) {
+        fprintf(stderr, "iio: unsupported type for in_%s: %s\n", channel_names[n], value);
+        return 1;
+    }
+
+    ch->be = endian == 'b';
+    ch->sign = sign == 's';
+    ch->bits = bits;
+    ch->storage = storage;
+    ch->shift = shift;
+
+    return 0;
+}
+
+/* channels are laid out in index order, each aligned to its own size */
+/* and the whole scan padded to the largest element */
+static void compute_layout(iio_t *iio) {
+    uint32_t offset = 0, largest = 1, bytes;
+    int order[IIO_NUM_CHANNELS];
+    int i, j, tmp;
+
+    for (i=0; i<IIO_NUM_CHANNELS; i++) {
+        order[i] = i;
+    }
+
+    for (i=1; i<IIO_NUM_CHANNELS; i++) {
+        for (j=i; j>0 && iio->ch[order[j-1]].index > iio->ch[order[j]].index; j--) {
+            tmp = order[j];
+            order[j] = order[j-1];
+            order[j-1] = tmp;
+        }
+    }
+
+    for (i=0; i<IIO_NUM_CHANNELS; i++) {
+        bytes = iio->ch[order[i]].storage / 8;
+        offset = (offset + bytes - 1) / bytes * bytes;
+        iio->ch[order[i]].offset = offset;
+        offset += bytes;
+        if (bytes > largest) {
+            largest = bytes;
+        }
+    }
+
+    iio->scan_size = (offset + largest - 1) / largest * largest;
+}
+
+/* raw value of a channel, sign extended into the low bits */
+static uint64_t extract(const struct iio_channel *ch, const uint8_t *scan) {
+    uint64_t value = 0, mask;
+    int bytes = ch->storage / 8;
+    int i;
+
+    scan += ch->offset;
+    for (i=0; i<bytes; i++) {
+        value |= (uint64_t)scan[ch->be ? i : bytes - 1 - i] << (8 * (bytes - 1 - i));
+    }
+
+    value >>= ch->shift;
+
+    if (ch->bits < 64) {
+        mask = ((uint64_t)1 << ch->bits) - 1;
+        value &= mask;
+        if (ch->sign && (value >> (ch->bits - 1)) & 1) {
+            value |= ~mask;
+        }
+    }
+
+    return value;
+}
+
+#define RAW(n) ((double)(int64_t)extract(&iio->ch[n], scan))
+
+static void decode(iio_t *iio, const uint8_t *scan, struct mpu6050_sample *dst) {
+    dst->data.acc.x = RAW(IIO_CH_ACCEL_X) * iio->acc_mult;
+    dst->data.acc.y = RAW(IIO_CH_ACCEL_Y) * iio->acc_mult;
+    dst->data.acc.z = RAW(IIO_CH_ACCEL_Z) * iio->acc_mult;
+    dst->data.temp = (RAW(IIO_CH_TEMP) + iio->temp_offset) * iio->temp_mult;
+    dst->data.gyro.x = RAW(IIO_CH_GYRO_X) * iio->gyro_mult;
+    dst->data.gyro.y = RAW(IIO_CH_GYRO_Y) * iio->gyro_mult;
+    dst->data.gyro.z = RAW(IIO_CH_GYRO_Z) * iio->gyro_mult;
+    dst->data.fsync = 0; /* the kernel driver owns REG_CONFIG, FSYNC is not latched */
+    dst->timestamp = extract(&iio->ch[IIO_CH_TIMESTAMP], scan);
+}
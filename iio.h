@@ -0,0 +1,78 @@
+/*
+ * This file is part of mpu6050.
+ *
+ * Copyright (C) 2025 William Clark
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+
+#ifndef IIO_H
+#define IIO_H
+
+#include <stdint.h>
+#include "mpu6050.h"
+
+/* scan elements exposed by the kernel inv_mpu6050 driver */
+#define IIO_CH_ACCEL_X   0
+#define IIO_CH_ACCEL_Y   1
+#define IIO_CH_ACCEL_Z   2
+#define IIO_CH_TEMP      3
+#define IIO_CH_GYRO_X    4
+#define IIO_CH_GYRO_Y    5
+#define IIO_CH_GYRO_Z    6
+#define IIO_CH_TIMESTAMP 7
+#define IIO_NUM_CHANNELS 8
+
+#define IIO_READ_SIZE 4096 /* bytes requested from the char device per read() */
+
+struct iio_config {
+    const char *sysfs; /* e.g. /sys/bus/iio/devices/iio:device0 */
+    const char *chrdev; /* e.g. /dev/iio:device0 */
+    uint32_t freq; /* sampling frequency in Hz, 0 = leave as is */
+    uint32_t length; /* kernel buffer length in scans, 0 = leave as is */
+};
+
+/* layout of one channel inside a scan, parsed from scan_elements */
+struct iio_channel {
+    uint8_t index;
+    uint8_t be; /* big endian */
+    uint8_t sign;
+    uint8_t bits;
+    uint8_t storage; /* bits */
+    uint8_t shift;
+    uint32_t offset; /* bytes from start of scan */
+};
+
+struct iio {
+    struct iio_config cfg;
+    struct iio_channel ch[IIO_NUM_CHANNELS];
+    int fd;
+    uint32_t scan_size; /* bytes per scan, including padding */
+    double acc_mult; /* raw => 1 mg */
+    double gyro_mult; /* raw => 0.1 deg / s */
+    double temp_mult; /* raw + temp_offset => 0.1 deg C */
+    double temp_offset;
+    uint32_t fill; /* bytes held in buf */
+    uint8_t buf[IIO_READ_SIZE];
+};
+
+typedef struct iio iio_t;
+
+int iio_init(iio_t *iio, const struct iio_config *cfg);
+int iio_deinit(iio_t *iio);
+int iio_read(iio_t *iio, mpu6050_t *mpu6050);
+int iio_read_batch(iio_t *iio, struct mpu6050_sample *dst, uint32_t max, uint32_t *count);
+
+#endif
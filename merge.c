@@ -0,0 +1,251 @@
+/*
+ * This file is part of mpu6050.
+ *
+ * Copyright (C) 2025 William Clark
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+
+/*
+
+Merges timestamped sample streams from several devices into frames
+holding one sample per device, taken at the same instant.
+
+Each device feeds batches (e.g. from iio_read_batch()) which are merged
+in timestamp order with a k-way min-heap. Merging stops as soon as any
+device runs out of buffered samples, since its next sample may still
+come first; feed it another batch and call merge_run() again.
+
+If the devices share an FSYNC pulse with cfg.ext_sync set, the rising
+edge seen by each device marks the same instant. Edges within edge_tol
+of the edge on device 0 move that device into the timebase of device 0.
+
+Samples come from mpu6050_read_sample(), which tags them with FSYNC but
+leaves the timestamp to the caller, or from iio_read_batch(). The kernel
+driver owns REG_CONFIG, so IIO samples never carry FSYNC and are merged
+on their kernel timestamps alone.
+
+*/
+
+#include <stddef.h>
+#include <string.h>
+#include <assert.h>
+
+#include "merge.h"
+
+static int64_t head_time(const merge_t *merge, uint8_t device);
+static void sift_down(merge_t *merge, uint32_t i);
+static void heapify(merge_t *merge);
+static void edge(merge_t *merge, uint8_t device, int64_t t);
+static void place(merge_t *merge, uint8_t device, const struct mpu6050_sample *s, int64_t t);
+
+int merge_init(merge_t *merge, uint32_t devices, uint64_t window, uint64_t edge_tol) {
+    assert(merge);
+
+    if (devices == 0 || devices > MERGE_MAX_DEVICES) {
+        return 1;
+    }
+
+    memset(merge, 0, sizeof *merge);
+    merge->devices = devices;
+    merge->window = window;
+    merge->edge_tol = edge_tol;
+
+    return 0;
+}
+
+/* hand over the next batch of a device, buf must stay valid until consumed */
+int merge_feed(merge_t *merge, uint32_t device, const struct mpu6050_sample *buf, uint32_t len) {
+    struct merge_stream *s;
+
+    assert(merge);
+
+    if (device >= merge->devices) {
+        return 1;
+    }
+
+    s = &merge->stream[device];
+
+    /* previous batch has not been consumed yet */
+    if (s->pos < s->len) {
+        return 1;
+    }
+
+    s->buf = buf;
+    s->len = len;
+    s->pos = 0;
+
+    if (len) {
+        merge->heap[merge->heap_size++] = device;
+        heapify(merge);
+    }
+
+    return 0;
+}
+
+/* emit up to max complete frames, returns number of frames written to dst */
+uint32_t merge_run(merge_t *merge, struct merge_frame *dst, uint32_t max) {
+    struct merge_stream *s;
+    const struct mpu6050_sample *sample;
+    uint32_t n = 0;
+    uint8_t device;
+    int64_t t;
+
+    assert(merge);
+
+    while (n < max && merge->heap_size == merge->devices) {
+        device = merge->heap[0];
+        s = &merge->stream[device];
+        sample = &s->buf[s->pos++];
+
+        if (s->pos == s->len) {
+            merge->heap[0] = merge->heap[--merge->heap_size];
+        }
+        sift_down(merge, 0);
+
+        if (sample->data.fsync && !s->fsync) {
+            edge(merge, device, (int64_t)sample->timestamp);
+        }
+        s->fsync = sample->data.fsync;
+
+        /* after edge(), so the edge sample is already realigned */
+        t = (int64_t)sample->timestamp - s->offset;
+
+        place(merge, device, sample, t);
+
+        if (merge->pending_count == merge->devices) {
+            dst[n++] = merge->pending;
+            merge->stats.frames++;
+            merge->stats.skew_sum += merge->pending.skew;
+            if (merge->pending.skew > merge->stats.skew_max) {
+                merge->stats.skew_max = merge->pending.skew;
+            }
+            merge->pending_mask = 0;
+            merge->pending_count = 0;
+        }
+    }
+
+    return n;
+}
+
+static int64_t head_time(const merge_t *merge, uint8_t device) {
+    const struct merge_stream *s = &merge->stream[device];
+
+    return (int64_t)s->buf[s->pos].timestamp - s->offset;
+}
+
+static void sift_down(merge_t *merge, uint32_t i) {
+    uint32_t child, smallest;
+    uint8_t tmp;
+
+    for (;;) {
+        smallest = i;
+        child = 2 * i + 1;
+
+        if (child < merge->heap_size
+            && head_time(merge, merge->heap[child]) < head_time(merge, merge->heap[smallest])) {
+            smallest = child;
+        }
+        child++;
+        if (child < merge->heap_size
+            && head_time(merge, merge->heap[child]) < head_time(merge, merge->heap[smallest])) {
+            smallest = child;
+        }
+
+        if (smallest == i) {
+            return;
+        }
+
+        tmp = merge->heap[i];
+        merge->heap[i] = merge->heap[smallest];
+        merge->heap[smallest] = tmp;
+        i = smallest;
+    }
+}
+
+static void heapify(merge_t *merge) {
+    uint32_t i;
+
+    for (i=merge->heap_size/2; i-- > 0; ) {
+        sift_down(merge, i);
+    }
+}
+
+/* FSYNC rising edge at raw device time t */
+static void edge(merge_t *merge, uint8_t device, int64_t t) {
+    struct merge_stream *s = &merge->stream[device];
+    struct merge_stream *ref = &merge->stream[0];
+    int64_t diff;
+    uint32_t i;
+    int moved = 0;
+
+    s->edge = t;
+    s->has_edge = 1;
+
+    if (!merge->edge_tol || !ref->has_edge) {
+        return;
+    }
+
+    if (device != 0) {
+        diff = s->edge - ref->edge;
+        if (diff <= (int64_t)merge->edge_tol && diff >= -(int64_t)merge->edge_tol) {
+            s->offset = diff;
+            merge->stats.edges++;
+            moved = 1;
+        }
+    } else {
+        /* device 0 may see the pulse after the others */
+        for (i=1; i<merge->devices; i++) {
+            diff = merge->stream[i].edge - ref->edge;
+            if (merge->stream[i].has_edge
+                && diff <= (int64_t)merge->edge_tol && diff >= -(int64_t)merge->edge_tol) {
+                merge->stream[i].offset = diff;
+                merge->stats.edges++;
+                moved = 1;
+            }
+        }
+    }
+
+    if (moved) {
+        heapify(merge);
+    }
+}
+
+/* add a sample to the pending frame, discarding it first if the sample */
+/* cannot belong to the same instant */
+static void place(merge_t *merge, uint8_t device, const struct mpu6050_sample *s, int64_t t) {
+    struct merge_frame *f = &merge->pending;
+
+    if (merge->pending_count
+        && ((merge->pending_mask >> device & 1) || (uint64_t)(t - (int64_t)f->timestamp) > merge->window)) {
+        merge->stats.dropped += merge->pending_count;
+        merge->pending_mask = 0;
+        merge->pending_count = 0;
+    }
+
+    if (!merge->pending_count) {
+        f->timestamp = t;
+        f->skew = 0;
+        f->fsync = 0;
+    }
+
+    f->sample[device] = *s;
+    f->sample[device].timestamp = t;
+    f->skew = t - (int64_t)f->timestamp;
+    f->fsync |= s->data.fsync;
+
+    merge->pending_mask |= 1u << device;
+    merge->pending_count++;
+}
@@ -0,0 +1,75 @@
+/*
+ * This file is part of mpu6050.
+ *
+ * Copyright (C) 2025 William Clark
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+
+#ifndef MERGE_H
+#define MERGE_H
+
+#include <stdint.h>
+#include "mpu6050.h"
+
+#define MERGE_MAX_DEVICES 8
+
+/* one batch of samples from a single device, consumed in place */
+struct merge_stream {
+    const struct mpu6050_sample *buf;
+    uint32_t len;
+    uint32_t pos;
+    int64_t offset; /* ns subtracted to move into the timebase of device 0 */
+    int64_t edge; /* timestamp of the last FSYNC rising edge */
+    uint8_t has_edge;
+    uint8_t fsync; /* FSYNC state of the previous sample */
+};
+
+/* one sample per device, timestamps in the timebase of device 0 */
+struct merge_frame {
+    struct mpu6050_sample sample[MERGE_MAX_DEVICES];
+    uint64_t timestamp; /* earliest sample in frame */
+    uint64_t skew; /* ns between earliest and latest sample */
+    uint8_t fsync; /* FSYNC seen by any device */
+};
+
+struct merge_stats {
+    uint32_t frames;
+    uint32_t dropped; /* samples that could not be placed in a complete frame */
+    uint32_t edges; /* FSYNC rising edges used to realign devices */
+    uint64_t skew_max;
+    uint64_t skew_sum; /* skew_sum / frames = mean skew */
+};
+
+struct merge {
+    uint32_t devices;
+    uint64_t window; /* max skew of a frame, ns */
+    uint64_t edge_tol; /* max distance between edges of the same pulse, 0 = off */
+    struct merge_stream stream[MERGE_MAX_DEVICES];
+    uint8_t heap[MERGE_MAX_DEVICES]; /* streams with data, min-heap on next timestamp */
+    uint32_t heap_size;
+    struct merge_frame pending;
+    uint32_t pending_mask;
+    uint32_t pending_count;
+    struct merge_stats stats;
+};
+
+typedef struct merge merge_t;
+
+int merge_init(merge_t *merge, uint32_t devices, uint64_t window, uint64_t edge_tol);
+int merge_feed(merge_t *merge, uint32_t device, const struct mpu6050_sample *buf, uint32_t len);
+uint32_t merge_run(merge_t *merge, struct merge_frame *dst, uint32_t max);
+
+#endif
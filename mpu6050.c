@@ -26,6 +26,7 @@
 
 static uint8_t acc_i16_shift(uint8_t fs);
 static uint8_t gyro_i16_shift(uint8_t fs);
+static uint8_t fsync_offset(uint8_t ext_sync);
 
 int mpu6050_init(mpu6050_t *mpu6050) {
     uint8_t id;
@@ -129,14 +130,11 @@ int mpu6050_read_temp(mpu6050_t *mpu6050) {
 /* if data_rdy interrupt is enabled, this will read all data synched */
 int mpu6050_read(mpu6050_t *mpu6050) {
     uint8_t data[14]; /* gyro + accel + temp */
-    uint8_t shift_gyro, shift_acc, int_status;
+    uint8_t int_status;
     int err = 0;
 
     assert(mpu6050);
 
-    shift_gyro = gyro_i16_shift(mpu6050->cfg.gyro);
-    shift_acc = acc_i16_shift(mpu6050->cfg.acc);
-
     /* if data_rdy interrupt is enabled, wait for data to be ready */
     if (mpu6050->cfg.int_enable.data_rdy) {
         do {
@@ -146,6 +144,34 @@ int mpu6050_read(mpu6050_t *mpu6050) {
     }
 
     err |= mpu6050->dev.read(REG_ACCEL_XOUT_H, data, 14);
+    mpu6050_decode(mpu6050, data);
+
+    return err;
+}
+
+/* mpu6050_read() into a struct mpu6050_sample, e.g. for merge_feed() */
+/* the driver has no clock, so the caller passes the time of the read */
+int mpu6050_read_sample(mpu6050_t *mpu6050, uint64_t timestamp, struct mpu6050_sample *dst) {
+    int err;
+
+    assert(dst);
+
+    err = mpu6050_read(mpu6050);
+    dst->data = mpu6050->data;
+    dst->timestamp = timestamp;
+
+    return err;
+}
+
+/* convert a 14 byte burst read from REG_ACCEL_XOUT_H into mpu6050->data */
+void mpu6050_decode(mpu6050_t *mpu6050, const uint8_t *data) {
+    uint8_t shift_gyro, shift_acc, fsync;
+
+    assert(mpu6050);
+
+    shift_gyro = gyro_i16_shift(mpu6050->cfg.gyro);
+    shift_acc = acc_i16_shift(mpu6050->cfg.acc);
+
     /* 0-5 acc */
     mpu6050->data.acc.x = (int16_t)(data[0] << 8 | data[1]) >> shift_acc;
     mpu6050->data.acc.y = (int16_t)(data[2] << 8 | data[3]) >> shift_acc;
@@ -156,14 +182,18 @@ int mpu6050_read(mpu6050_t *mpu6050) {
     mpu6050->data.gyro.x = (int16_t)(data[8] << 8 | data[9]) >> shift_gyro;
     mpu6050->data.gyro.y = (int16_t)(data[10] << 8 | data[11]) >> shift_gyro;
     mpu6050->data.gyro.z = (int16_t)(data[12] << 8 | data[13]) >> shift_gyro;
-
-    return err;
+    /* FSYNC state replaces the lsb of the selected register, masked */
+    /* as mpu6050_configure() writes it */
+    fsync = fsync_offset(mpu6050->cfg.ext_sync & 0x07);
+    if (fsync) {
+        mpu6050->data.fsync = data[fsync] & 1;
+    }
 }
 
 /* write configuration to device */
 /* then sleep for 200 ms */
 int mpu6050_configure(mpu6050_t *mpu6050) {
-    uint8_t sig_path, dlpl, sleep, inten;
+    uint8_t sig_path, dlpl, ext_sync, sleep, inten;
     uint8_t acc, gyro;
     int err = 0;
     
@@ -175,6 +205,9 @@ int mpu6050_configure(mpu6050_t *mpu6050) {
     /* digital low-pass filter level */
     dlpl = mpu6050->cfg.dlpl & 0x07;
 
+    /* FSYNC pin latch location */
+    ext_sync = (mpu6050->cfg.ext_sync & 0x07) << 3;
+
     /* INT_ENABLE */
     inten = mpu6050->cfg.int_enable.data_rdy & 1;
     inten |= (mpu6050->cfg.int_enable.i2c_mst & 1) << 3;
@@ -193,7 +226,7 @@ int mpu6050_configure(mpu6050_t *mpu6050) {
     err |= mpu6050->dev.write(REG_SMPLRT_DIV, mpu6050->cfg.sdiv);
     err |= mpu6050->dev.write(REG_SIGNAL_PATH_RESET, sig_path);
     err |= mpu6050->dev.write(REG_INT_ENABLE, inten);
-    err |= mpu6050->dev.write(REG_CONFIG, dlpl);
+    err |= mpu6050->dev.write(REG_CONFIG, ext_sync | dlpl);
     err |= mpu6050->dev.write(REG_ACCEL_CONFIG, acc);
     err |= mpu6050->dev.write(REG_GYRO_CONFIG, gyro);
     err |= mpu6050->dev.write(REG_PWR_MGMT1, sleep);
@@ -322,4 +355,19 @@ static uint8_t gyro_i16_shift(uint8_t fs) {
         case MPU6050_GYRO_FS_2000: return 1;
         default:                   return 0;
     }
+}
+
+/* Offset of the low byte latching FSYNC within the 14 byte burst at ACCEL_XOUT_H */
+/* 0 if FSYNC is not latched */
+static uint8_t fsync_offset(uint8_t ext_sync) {
+    switch(ext_sync) {
+        case MPU6050_EXT_SYNC_TEMP_OUT_L:  return 7;
+        case MPU6050_EXT_SYNC_GYRO_XOUT_L: return 9;
+        case MPU6050_EXT_SYNC_GYRO_YOUT_L: return 11;
+        case MPU6050_EXT_SYNC_GYRO_ZOUT_L: return 13;
+        case MPU6050_EXT_SYNC_ACC_XOUT_L:  return 1;
+        case MPU6050_EXT_SYNC_ACC_YOUT_L:  return 3;
+        case MPU6050_EXT_SYNC_ACC_ZOUT_L:  return 5;
+        default:                           return 0;
+    }
 }
\ No newline at end of file
@@ -35,6 +35,16 @@
 #define MPU6050_ACC_FS_8G    0x02 /* ± 8g */
 #define MPU6050_ACC_FS_16G   0x03 /* ± 16g */
 
+/* FSYNC pin latch location (EXT_SYNC_SET) */
+#define MPU6050_EXT_SYNC_DISABLED    0x00
+#define MPU6050_EXT_SYNC_TEMP_OUT_L  0x01
+#define MPU6050_EXT_SYNC_GYRO_XOUT_L 0x02
+#define MPU6050_EXT_SYNC_GYRO_YOUT_L 0x03
+#define MPU6050_EXT_SYNC_GYRO_ZOUT_L 0x04
+#define MPU6050_EXT_SYNC_ACC_XOUT_L  0x05
+#define MPU6050_EXT_SYNC_ACC_YOUT_L  0x06
+#define MPU6050_EXT_SYNC_ACC_ZOUT_L  0x07
+
 #define MPU6050_CALIBRATION_SAMPLES 100
 
 struct mpu6050_dev {
@@ -59,6 +69,7 @@ struct mpu6050_config {
     uint8_t acc;
     uint8_t dlpl; /* digital low-pass filter level [0-7]*/
     uint8_t sdiv; /* sample rate divider. ~ lpl; lpl=(0,7) => divides 8KHz else 1 KHz*/
+    uint8_t ext_sync; /* register whose lsb latches the FSYNC pin [0-7], 0 = off */
     struct mpu6050_int_enable int_enable;
 };
 
@@ -81,6 +92,13 @@ struct mpu6050_data {
     struct mpu6050_accelerometer acc;
     struct mpu6050_gyroscope gyro;
     int16_t temp;
+    uint8_t fsync; /* FSYNC pin state, valid if cfg.ext_sync is set */
+};
+
+/* a single timestamped sample, as delivered by batched backends */
+struct mpu6050_sample {
+    struct mpu6050_data data;
+    uint64_t timestamp; /* ns */
 };
 
 struct mpu6050 {
@@ -97,6 +115,8 @@ int mpu6050_read_acc(mpu6050_t *mpu6050);
 int mpu6050_read_gyro(mpu6050_t *mpu6050);
 int mpu6050_read_temp(mpu6050_t *mpu6050);
 int mpu6050_read(mpu6050_t *mpu6050);
+int mpu6050_read_sample(mpu6050_t *mpu6050, uint64_t timestamp, struct mpu6050_sample *dst);
+void mpu6050_decode(mpu6050_t *mpu6050, const uint8_t *data);
 int mpu6050_configure(mpu6050_t *mpu6050);
 int mpu6050_calibrate_gyro(mpu6050_t *mpu6050);
 int mpu6050_reset(mpu6050_t *mpu6050);
@@ -0,0 +1,325 @@
+/*
+ * This file is part of mpu6050.
+ *
+ * Copyright (C) 2025 William Clark
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+
+/*
+
+On-node vibration analysis of the accelerometer and gyro streams.
+
+Every hop samples the last n samples of each channel have their mean
+removed, are Hann windowed and transformed with a real FFT. The real FFT
+packs even/odd samples into a complex FFT of n/2 points, done in place
+as radix-4 stages (plus one radix-2 stage if needed) on split re/im
+arrays, so the inner loops are unit stride and left to the compiler to
+vectorize. Band power and the spectral peak are accumulated per window,
+RMS per sample, and a report is produced every cfg.report windows.
+
+*/
+
+#include <stddef.h>
+#include <string.h>
+#include <math.h>
+#include <assert.h>
+
+#include "spectrum.h"
+
+#define PI 3.14159265358979323846
+
+static void fft(spectrum_t *sp);
+static void analyse(spectrum_t *sp, struct spectrum_channel *ch);
+static void summarise(spectrum_t *sp, struct spectrum_report *dst);
+
+int spectrum_init(spectrum_t *sp, const struct spectrum_config *cfg) {
+    uint32_t m, h, k, i, off, bits;
+    double sum_w = 0, sum_w2 = 0, a;
+
+    assert(sp);
+    assert(cfg);
+
+    if (cfg->n < 8 || cfg->n > SPECTRUM_MAX_N || (cfg->n & (cfg->n - 1))
+        || cfg->hop == 0 || cfg->hop > cfg->n || cfg->report == 0
+        || cfg->rate <= 0 || cfg->bands > SPECTRUM_MAX_BANDS) {
+        return 1;
+    }
+
+    for (i=0; i<cfg->bands; i++) {
+        if (cfg->band[i].lo < 0 || cfg->band[i].hi < cfg->band[i].lo) {
+            return 1;
+        }
+    }
+
+    memset(sp, 0, sizeof *sp);
+    sp->cfg = *cfg;
+    m = cfg->n / 2;
+
+    for (sp->log2m=0; (1u << sp->log2m) < m; sp->log2m++)
+        ;
+
+    /* periodic Hann window */
+    for (i=0; i<cfg->n; i++) {
+        sp->window[i] = 0.5 - 0.5 * cos(2 * PI * i / cfg->n);
+        sum_w += sp->window[i];
+        sum_w2 += sp->window[i] * sp->window[i];
+    }
+
+    /* Parseval, corrected for the energy lost to the window */
+    sp->scale_ms = 1.0 / (cfg->n * sum_w2);
+    sp->scale_amp = 2.0 / sum_w;
+
+    for (i=0; i<m; i++) {
+        for (bits=0, k=0; k<sp->log2m; k++) {
+            bits |= ((i >> k) & 1) << (sp->log2m - 1 - k);
+        }
+        sp->rev[i] = bits;
+    }
+
+    /* W(4h)^k followed by W(2h)^k for each radix-4 stage */
+    off = 0;
+    for (h=(sp->log2m & 1) ? 2 : 1; h<m; h*=4) {
+        for (k=0; k<h; k++) {
+            a = -2 * PI * k / (4 * h);
+            sp->tw_re[off + k] = cos(a);
+            sp->tw_im[off + k] = sin(a);
+            sp->tw_re[off + h + k] = cos(2 * a);
+            sp->tw_im[off + h + k] = sin(2 * a);
+        }
+        off += 2 * h;
+    }
+
+    for (k=0; k<m; k++) {
+        a = -2 * PI * k / cfg->n;
+        sp->rt_re[k] = cos(a);
+        sp->rt_im[k] = sin(a);
+    }
+
+    for (i=0; i<cfg->bands; i++) {
+        sp->band_lo[i] = ceil(cfg->band[i].lo * cfg->n / cfg->rate);
+        sp->band_hi[i] = floor(cfg->band[i].hi * cfg->n / cfg->rate);
+        if (sp->band_hi[i] > m) {
+            sp->band_hi[i] = m;
+        }
+    }
+
+    return 0;
+}
+
+/* push one sample of every channel, returns 1 if a report was written to dst */
+uint32_t spectrum_push(spectrum_t *sp, const struct mpu6050_data *data, struct spectrum_report *dst) {
+    float v[SPECTRUM_CHANNELS];
+    struct spectrum_channel *ch;
+    int i;
+
+    assert(sp);
+    assert(data);
+
+    v[SPECTRUM_ACC_X] = data->acc.x;
+    v[SPECTRUM_ACC_Y] = data->acc.y;
+    v[SPECTRUM_ACC_Z] = data->acc.z;
+    v[SPECTRUM_GYRO_X] = data->gyro.x;
+    v[SPECTRUM_GYRO_Y] = data->gyro.y;
+    v[SPECTRUM_GYRO_Z] = data->gyro.z;
+
+    for (i=0; i<SPECTRUM_CHANNELS; i++) {
+        ch = &sp->ch[i];
+        ch->ring[sp->head] = v[i];
+        ch->sum += v[i];
+        ch->sum_sq += v[i] * v[i];
+    }
+
+    sp->head = (sp->head + 1) & (sp->cfg.n - 1);
+    sp->samples++;
+    sp->since++;
+    if (sp->filled < sp->cfg.n) {
+        sp->filled++;
+    }
+
+    if (sp->filled < sp->cfg.n || sp->since < sp->cfg.hop) {
+        return 0;
+    }
+
+    sp->since = 0;
+    for (i=0; i<SPECTRUM_CHANNELS; i++) {
+        analyse(sp, &sp->ch[i]);
+    }
+
+    if (++sp->windows < sp->cfg.report) {
+        return 0;
+    }
+
+    summarise(sp, dst);
+
+    return 1;
+}
+
+/* in place complex FFT of m points in re/im, input in bit reversed order */
+static void fft(spectrum_t *sp) {
+    uint32_t m = sp->cfg.n / 2;
+    uint32_t h, j, k, off = 0;
+    float *re = sp->re, *im = sp->im;
+    const float *w1r, *w1i, *w2r, *w2i;
+    float ar, ai, br, bi;
+    float x0r, x0i, x1r, x1i, x2r, x2i, x3r, x3i;
+    float a0r, a0i, a1r, a1i, a2r, a2i, a3r, a3i;
+
+    h = 1;
+    if (sp->log2m & 1) {
+        for (j=0; j<m; j+=2) {
+            ar = re[j]; ai = im[j];
+            br = re[j+1]; bi = im[j+1];
+            re[j] = ar + br; im[j] = ai + bi;
+            re[j+1] = ar - br; im[j+1] = ai - bi;
+        }
+        h = 2;
+    }
+
+    /* two radix-2 stages (half sizes h and 2h) fused into one radix-4 */
+    for (; h<m; h*=4) {
+        w2r = sp->tw_re + off;
+        w2i = sp->tw_im + off;
+        w1r = w2r + h;
+        w1i = w2i + h;
+
+        for (j=0; j<m; j+=4*h) {
+            for (k=0; k<h; k++) {
+                x0r = re[j+k];     x0i = im[j+k];
+                x1r = re[j+k+h];   x1i = im[j+k+h];
+                x2r = re[j+k+2*h]; x2i = im[j+k+2*h];
+                x3r = re[j+k+3*h]; x3i = im[j+k+3*h];
+
+                /* first stage, twiddle W(2h)^k */
+                br = x1r * w1r[k] - x1i * w1i[k];
+                bi = x1r * w1i[k] + x1i * w1r[k];
+                a0r = x0r + br; a0i = x0i + bi;
+                a1r = x0r - br; a1i = x0i - bi;
+
+                br = x3r * w1r[k] - x3i * w1i[k];
+                bi = x3r * w1i[k] + x3i * w1r[k];
+                a2r = x2r + br; a2i = x2i + bi;
+                a3r = x2r - br; a3i = x2i - bi;
+
+                /* second stage, twiddles W(4h)^k and -i W(4h)^k */
+                br = a2r * w2r[k] - a2i * w2i[k];
+                bi = a2r * w2i[k] + a2i * w2r[k];
+                re[j+k] = a0r + br;     im[j+k] = a0i + bi;
+                re[j+k+2*h] = a0r - br; im[j+k+2*h] = a0i - bi;
+
+                br = a3r * w2i[k] + a3i * w2r[k];
+                bi = -(a3r * w2r[k] - a3i * w2i[k]);
+                re[j+k+h] = a1r + br;   im[j+k+h] = a1i + bi;
+                re[j+k+3*h] = a1r - br; im[j+k+3*h] = a1i - bi;
+            }
+        }
+
+        off += 2 * h;
+    }
+}
+
+/* window the last n samples of a channel and accumulate its spectrum */
+static void analyse(spectrum_t *sp, struct spectrum_channel *ch) {
+    uint32_t n = sp->cfg.n, m = n / 2, mask = n - 1;
+    uint32_t i, k, lo, hi;
+    const float *ring = ch->ring;
+    float *pwr = sp->pwr;
+    float mean = 0;
+    float zr, zi, cr, ci, er, ei, or_, oi, xr, xi;
+    double sum;
+
+    for (i=0; i<n; i++) {
+        mean += ring[i];
+    }
+    mean /= n;
+
+    /* even samples to re, odd to im, oldest sample (at head) first */
+    for (k=0; k<m; k++) {
+        i = 2 * k;
+        sp->re[sp->rev[k]] = (ring[(sp->head + i) & mask] - mean) * sp->window[i];
+        sp->im[sp->rev[k]] = (ring[(sp->head + i + 1) & mask] - mean) * sp->window[i+1];
+    }
+
+    fft(sp);
+
+    /* split into the spectrum of the real input, X[k] = E[k] + W(n)^k O[k] */
+    pwr[0] = (sp->re[0] + sp->im[0]) * (sp->re[0] + sp->im[0]);
+    pwr[m] = (sp->re[0] - sp->im[0]) * (sp->re[0] - sp->im[0]);
+    for (k=1; k<m; k++) {
+        zr = sp->re[k];   zi = sp->im[k];
+        cr = sp->re[m-k]; ci = -sp->im[m-k];
+        er = 0.5f * (zr + cr);
+        ei = 0.5f * (zi + ci);
+        or_ = 0.5f * (zi - ci);
+        oi = -0.5f * (zr - cr);
+        xr = er + sp->rt_re[k] * or_ - sp->rt_im[k] * oi;
+        xi = ei + sp->rt_re[k] * oi + sp->rt_im[k] * or_;
+        pwr[k] = xr * xr + xi * xi;
+    }
+
+    for (k=1; k<=m; k++) {
+        if (pwr[k] > ch->peak_pwr) {
+            ch->peak_pwr = pwr[k];
+            ch->peak_bin = k;
+        }
+    }
+
+    for (i=0; i<sp->cfg.bands; i++) {
+        lo = sp->band_lo[i];
+        hi = sp->band_hi[i];
+        for (sum=0, k=lo; k<=hi; k++) {
+            /* one sided, all bins but DC and nyquist count twice */
+            sum += (k == 0 || k == m) ? pwr[k] : 2 * pwr[k];
+        }
+        ch->band[i] += sum * sp->scale_ms;
+    }
+}
+
+static void summarise(spectrum_t *sp, struct spectrum_report *dst) {
+    struct spectrum_channel *ch;
+    struct spectrum_summary *s;
+    double mean, var;
+    uint32_t i, b;
+
+    for (i=0; i<SPECTRUM_CHANNELS; i++) {
+        ch = &sp->ch[i];
+        s = &dst->ch[i];
+
+        mean = ch->sum / sp->samples;
+        var = ch->sum_sq / sp->samples - mean * mean;
+        s->rms = var > 0 ? sqrt(var) : 0;
+        s->peak_freq = ch->peak_bin * sp->cfg.rate / sp->cfg.n;
+        s->peak_amp = sqrt(ch->peak_pwr) * sp->scale_amp;
+        /* DC and nyquist have no mirror image in the one sided spectrum */
+        if (ch->peak_bin == sp->cfg.n / 2) {
+            s->peak_amp /= 2;
+        }
+
+        for (b=0; b<SPECTRUM_MAX_BANDS; b++) {
+            s->band[b] = b < sp->cfg.bands ? ch->band[b] / sp->windows : 0;
+            ch->band[b] = 0;
+        }
+
+        ch->sum = 0;
+        ch->sum_sq = 0;
+        ch->peak_pwr = 0;
+        ch->peak_bin = 0;
+    }
+
+    dst->windows = sp->windows;
+    dst->samples = sp->samples;
+    sp->windows = 0;
+    sp->samples = 0;
+}
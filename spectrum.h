@@ -0,0 +1,106 @@
+/*
+ * This file is part of mpu6050.
+ *
+ * Copyright (C) 2025 William Clark
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+
+#ifndef SPECTRUM_H
+#define SPECTRUM_H
+
+#include <stdint.h>
+#include "mpu6050.h"
+
+#define SPECTRUM_MAX_N     1024 /* largest FFT length */
+#define SPECTRUM_MAX_BANDS 8
+
+/* channels taken from struct mpu6050_data */
+#define SPECTRUM_ACC_X    0
+#define SPECTRUM_ACC_Y    1
+#define SPECTRUM_ACC_Z    2
+#define SPECTRUM_GYRO_X   3
+#define SPECTRUM_GYRO_Y   4
+#define SPECTRUM_GYRO_Z   5
+#define SPECTRUM_CHANNELS 6
+
+struct spectrum_band {
+    float lo; /* Hz */
+    float hi; /* Hz */
+};
+
+struct spectrum_config {
+    uint32_t n; /* FFT length, power of 2 in [8, SPECTRUM_MAX_N] */
+    uint32_t hop; /* samples between windows, n/2 => 50% overlap */
+    uint32_t report; /* windows per report */
+    float rate; /* sample rate, Hz */
+    uint32_t bands;
+    struct spectrum_band band[SPECTRUM_MAX_BANDS];
+};
+
+/* values are in driver units, i.e. mg for acc and 0.1 deg / s for gyro */
+struct spectrum_summary {
+    float rms; /* with the mean removed */
+    float peak_freq; /* Hz, largest non-DC bin over all windows */
+    float peak_amp; /* amplitude of a sine at peak_freq */
+    float band[SPECTRUM_MAX_BANDS]; /* mean square within each band */
+};
+
+struct spectrum_report {
+    struct spectrum_summary ch[SPECTRUM_CHANNELS];
+    uint32_t windows;
+    uint32_t samples;
+};
+
+/* running state of one channel */
+struct spectrum_channel {
+    float ring[SPECTRUM_MAX_N];
+    double sum;
+    double sum_sq;
+    double band[SPECTRUM_MAX_BANDS];
+    float peak_pwr;
+    uint32_t peak_bin;
+};
+
+struct spectrum {
+    struct spectrum_config cfg;
+    uint32_t log2m; /* complex FFT of m = n/2 points */
+    uint32_t head; /* next ring slot */
+    uint32_t filled;
+    uint32_t since; /* samples since last window */
+    uint32_t windows;
+    uint32_t samples;
+    uint32_t band_lo[SPECTRUM_MAX_BANDS];
+    uint32_t band_hi[SPECTRUM_MAX_BANDS];
+    double scale_ms; /* |X|^2 => mean square */
+    double scale_amp; /* |X| => sine amplitude */
+    float window[SPECTRUM_MAX_N];
+    float tw_re[SPECTRUM_MAX_N / 2]; /* radix-4 twiddles, contiguous per stage */
+    float tw_im[SPECTRUM_MAX_N / 2];
+    float rt_re[SPECTRUM_MAX_N / 2]; /* real split twiddles */
+    float rt_im[SPECTRUM_MAX_N / 2];
+    uint16_t rev[SPECTRUM_MAX_N / 2];
+    float re[SPECTRUM_MAX_N / 2];
+    float im[SPECTRUM_MAX_N / 2];
+    float pwr[SPECTRUM_MAX_N / 2 + 1];
+    struct spectrum_channel ch[SPECTRUM_CHANNELS];
+};
+
+typedef struct spectrum spectrum_t;
+
+int spectrum_init(spectrum_t *sp, const struct spectrum_config *cfg);
+uint32_t spectrum_push(spectrum_t *sp, const struct mpu6050_data *data, struct spectrum_report *dst);
+
+#endif
@@ -0,0 +1,218 @@
+/*
+ * This file is part of mpu6050.
+ *
+ * Copyright (C) 2025 William Clark
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+
+/*
+
+Drives two MPU-6050s at 0x68 and 0x69 through the bus scheduler, with
+the xfer hook standing in for I2C_RDWR on a register file per device.
+Both are set up with mpu6050_init() and mpu6050_configure() through
+bus_mpu6050_attach(), with none of those one-off accesses counted late,
+then their periodic bursts are decoded by bus_mpu6050_done() and must go
+out as one combined transfer. Also checks that reads are only merged on
+devices added with BUS_AUTO_INC, that a failed transfer leaves nothing
+queued, that bus_deinit() frees the attach slots and that a 0 Hz bus is
+rejected.
+
+*/
+
+#include <stdio.h>
+#include <string.h>
+
+#include "bus.h"
+#include "mpu6050.h"
+#include "registers.h"
+
+#define DEVICES 2
+#define RATE    1000
+
+static uint8_t regs[DEVICES][128];
+static uint32_t xfers;
+static int fail; /* next fake_xfer() fails */
+static int failures;
+
+static int fake_xfer(struct i2c_msg *msgs, uint32_t n);
+static int fake_sleep(uint32_t dur_us);
+
+int main(void) {
+    static bus_t bus;
+    mpu6050_t mpu6050[BUS_MAX_DEVICES];
+    uint8_t id[BUS_MAX_DEVICES], inc, buf[BUS_MAX_QUEUE][2];
+    uint32_t d, transfers, merged;
+    uint64_t now;
+
+    if (!bus_init(&bus, NULL, 0)) {
+        fprintf(stderr, "0 Hz bus accepted\n");
+        failures++;
+    }
+
+    bus_init(&bus, NULL, BUS_FAST_HZ);
+    bus.xfer = fake_xfer;
+
+    for (d=0; d<DEVICES; d++) {
+        regs[d][REG_WHO_AM_I] = 0x68;
+        regs[d][REG_INT_STATUS] = 1;
+
+        if (bus_add(&bus, 0x68 + d, 0, RATE, REG_ACCEL_XOUT_H, 14, bus_mpu6050_done, &mpu6050[d], &id[d])
+            || bus_mpu6050_attach(&bus, id[d], &mpu6050[d])) {
+            fprintf(stderr, "could not add device %lu\n", (unsigned long)d);
+            return 1;
+        }
+
+        mpu6050[d].dev.init = NULL;
+        mpu6050[d].dev.deinit = NULL;
+        mpu6050[d].dev.sleep = fake_sleep;
+
+        if (mpu6050_init(&mpu6050[d])) {
+            fprintf(stderr, "mpu6050_init() of device %lu failed\n", (unsigned long)d);
+            return 1;
+        }
+
+        mpu6050[d].cfg.acc = MPU6050_ACC_FS_8G;
+        if (mpu6050_configure(&mpu6050[d])) {
+            fprintf(stderr, "mpu6050_configure() of device %lu failed\n", (unsigned long)d);
+            return 1;
+        }
+    }
+
+    if (bus.stats.late) {
+        fprintf(stderr, "%lu of %lu transactions late after configure\n",
+            (unsigned long)bus.stats.late, (unsigned long)bus.stats.xacts);
+        failures++;
+    }
+
+    for (d=0; d<DEVICES; d++) {
+        if (regs[d][REG_ACCEL_CONFIG] != MPU6050_ACC_FS_8G << 3) {
+            fprintf(stderr, "device %lu: ACCEL_CONFIG 0x%02x\n", (unsigned long)d, regs[d][REG_ACCEL_CONFIG]);
+            failures++;
+        }
+
+        /* 4 lsb / mg at 8 g */
+        regs[d][REG_ACCEL_XOUT_H] = (4000 >> d) >> 8;
+        regs[d][REG_ACCEL_XOUT_H + 1] = (4000 >> d) & 0xFF;
+        memset(&mpu6050[d].data, 0, sizeof mpu6050[d].data);
+    }
+
+    /* past the release of the next sample of both devices */
+    now = bus_now() + 2000000000ul / RATE;
+    transfers = bus.stats.transfers;
+    xfers = 0;
+
+    if (bus_run(&bus, now)) {
+        failures++;
+    }
+
+    if (xfers != 1 || bus.stats.transfers != transfers + 1) {
+        fprintf(stderr, "periodic reads took %lu transfers\n", (unsigned long)xfers);
+        failures++;
+    }
+
+    for (d=0; d<DEVICES; d++) {
+        if (mpu6050[d].data.acc.x != 1000 >> d) {
+            fprintf(stderr, "device %lu: acc.x %d\n", (unsigned long)d, mpu6050[d].data.acc.x);
+            failures++;
+        }
+    }
+
+    /* FIFO_COUNT then FIFO_R_W must stay two reads */
+    now = bus_now();
+    merged = bus.stats.merged;
+    bus_queue_read(&bus, id[0], REG_FIFO_COUNT_H, buf[0], 2, now);
+    bus_queue_read(&bus, id[0], REG_FIFO_R_W, buf[1], 1, now);
+    bus_run(&bus, now);
+    if (bus.stats.merged != merged) {
+        fprintf(stderr, "reads merged without BUS_AUTO_INC\n");
+        failures++;
+    }
+
+    /* the same registers through an auto-incrementing address are */
+    bus_add(&bus, 0x68, BUS_AUTO_INC, 0, 0, 0, NULL, NULL, &inc);
+    bus_queue_read(&bus, inc, REG_ACCEL_XOUT_H, buf[0], 2, now);
+    bus_queue_read(&bus, inc, REG_ACCEL_XOUT_H + 2, buf[1], 2, now);
+    bus_run(&bus, now);
+    if (bus.stats.merged != merged + 1) {
+        fprintf(stderr, "reads not merged with BUS_AUTO_INC\n");
+        failures++;
+    }
+
+    /* more reads than fit one transfer, the first of which fails */
+    for (d=0; d<BUS_MAX_QUEUE - DEVICES; d++) {
+        bus_queue_read(&bus, inc, REG_WHO_AM_I, buf[d], 1, now);
+    }
+    fail = 1;
+    if (!bus_run(&bus, now) || bus.queued) {
+        fprintf(stderr, "failed transfer left %lu queued\n", (unsigned long)bus.queued);
+        failures++;
+    }
+
+    bus_deinit(&bus);
+
+    /* every slot must be free again */
+    bus_init(&bus, NULL, BUS_FAST_HZ);
+    for (d=0; d<BUS_MAX_DEVICES; d++) {
+        if (bus_add(&bus, 0x68 + d % DEVICES, 0, 0, 0, 0, NULL, NULL, &id[d])
+            || bus_mpu6050_attach(&bus, id[d], &mpu6050[d])) {
+            fprintf(stderr, "attach %lu after bus_deinit() failed\n", (unsigned long)d);
+            failures++;
+            break;
+        }
+    }
+    bus_deinit(&bus);
+
+    printf("bus_test: %s\n", failures ? "FAIL" : "ok");
+
+    return failures != 0;
+}
+
+/* a write sets the register pointer and, with a value, the register */
+static int fake_xfer(struct i2c_msg *msgs, uint32_t n) {
+    static uint8_t ptr[DEVICES];
+    uint32_t i, d;
+
+    xfers++;
+
+    if (fail) {
+        fail = 0;
+        return 1;
+    }
+
+    for (i=0; i<n; i++) {
+        d = msgs[i].addr - 0x68;
+        if (d >= DEVICES) {
+            return 1;
+        }
+
+        if (msgs[i].flags & I2C_M_RD) {
+            memcpy(msgs[i].buf, regs[d] + ptr[d], msgs[i].len);
+        } else {
+            ptr[d] = msgs[i].buf[0] & 0x7F;
+            if (msgs[i].len == 2) {
+                regs[d][ptr[d]] = msgs[i].buf[1];
+            }
+        }
+    }
+
+    return 0;
+}
+
+static int fake_sleep(uint32_t dur_us) {
+    (void)dur_us;
+
+    return 0;
+}
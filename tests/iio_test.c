@@ -0,0 +1,287 @@
+/*
+ * This file is part of mpu6050.
+ *
+ * Copyright (C) 2025 William Clark
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+
+/*
+
+Drives the IIO backend from a scratch sysfs tree and a FIFO standing in
+for /dev/iio:deviceN. A child process writes SCANS scans laid out like
+the inv_mpu6050 driver does (7 x be:s16, 2 bytes padding, le:s64
+timestamp at offset 16) in chunks that split scans, and the parent
+checks the decoded values through iio_read() and iio_read_batch().
+
+*/
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#include "iio.h"
+
+#define SCANS 100
+#define SCAN_SIZE 24
+#define CHUNK 7 /* bytes per write(), splits scans */
+
+static const char *channels[IIO_NUM_CHANNELS] = {
+    "accel_x", "accel_y", "accel_z", "temp",
+    "anglvel_x", "anglvel_y", "anglvel_z", "timestamp"
+};
+
+static char root[64];
+static int failures;
+
+static void put(const char *file, const char *value);
+static int get(const char *file, const char *expect);
+static void writer(const char *fifo);
+static void check(const struct mpu6050_sample *s, uint32_t k);
+static void cleanup(void);
+
+int main(void) {
+    char sysfs[96], fifo[96], file[128], value[16];
+    struct iio_config cfg;
+    struct mpu6050_sample batch[16];
+    mpu6050_t mpu6050;
+    iio_t iio;
+    uint32_t k = 0, count, i;
+    pid_t pid;
+    int status;
+
+    strcpy(root, "/tmp/iio_test.XXXXXX");
+    if (mkdtemp(root) == NULL) {
+        perror("mkdtemp");
+        return 1;
+    }
+
+    sprintf(sysfs, "%s/iio:device0", root);
+    sprintf(fifo, "%s/chrdev", root);
+    mkdir(sysfs, 0700);
+    sprintf(file, "%s/buffer", sysfs);
+    mkdir(file, 0700);
+    sprintf(file, "%s/scan_elements", sysfs);
+    mkdir(file, 0700);
+
+    for (i=0; i<IIO_NUM_CHANNELS; i++) {
+        sprintf(file, "scan_elements/in_%s_index", channels[i]);
+        sprintf(value, "%lu\n", (unsigned long)i);
+        put(file, value);
+        sprintf(file, "scan_elements/in_%s_type", channels[i]);
+        put(file, i == IIO_CH_TIMESTAMP ? "le:s64/64>>0\n" : "be:s16/16>>0\n");
+    }
+
+    /* 16384 lsb / g, 131 lsb / deg/s */
+    put("in_accel_scale", "0.000598551\n");
+    put("in_anglvel_scale", "0.000133232\n");
+    put("in_temp_scale", "2.941176\n");
+    put("in_temp_offset", "12420\n");
+
+    if (mkfifo(fifo, 0600)) {
+        perror("mkfifo");
+        cleanup();
+        return 1;
+    }
+
+    pid = fork();
+    if (pid == 0) {
+        writer(fifo);
+        _exit(0);
+    }
+
+    memset(&cfg, 0, sizeof cfg);
+    cfg.sysfs = sysfs;
+    cfg.chrdev = fifo;
+    cfg.freq = 1000;
+    cfg.length = 64;
+
+    if (iio_init(&iio, &cfg)) {
+        fprintf(stderr, "iio_init() failed\n");
+        cleanup();
+        return 1;
+    }
+
+    if (iio.scan_size != SCAN_SIZE || iio.ch[IIO_CH_TIMESTAMP].offset != 16) {
+        fprintf(stderr, "scan size %lu, timestamp at %lu\n",
+            (unsigned long)iio.scan_size, (unsigned long)iio.ch[IIO_CH_TIMESTAMP].offset);
+        failures++;
+    }
+
+    for (; k<10; k++) {
+        if (iio_read(&iio, &mpu6050)) {
+            break;
+        }
+        batch[0].data = mpu6050.data;
+        batch[0].timestamp = 1000000 + k;
+        check(&batch[0], k);
+    }
+
+    while (k < SCANS && !iio_read_batch(&iio, batch, 16, &count)) {
+        for (i=0; i<count; i++, k++) {
+            check(&batch[i], k);
+        }
+    }
+
+    if (k != SCANS) {
+        fprintf(stderr, "got %lu of %d scans\n", (unsigned long)k, SCANS);
+        failures++;
+    }
+
+    iio_deinit(&iio);
+    waitpid(pid, &status, 0);
+
+    failures += get("buffer/enable", "0");
+    failures += get("buffer/length", "64");
+    failures += get("sampling_frequency", "1000");
+    failures += get("scan_elements/in_timestamp_en", "1");
+
+    cleanup();
+
+    printf("iio_test: %s\n", failures ? "FAIL" : "ok");
+
+    return failures != 0;
+}
+
+static void put(const char *file, const char *value) {
+    char path[160];
+    FILE *f;
+
+    sprintf(path, "%s/iio:device0/%s", root, file);
+    f = fopen(path, "w");
+    if (f != NULL) {
+        fputs(value, f);
+        fclose(f);
+    }
+}
+
+static int get(const char *file, const char *expect) {
+    char path[160], value[32] = "";
+    FILE *f;
+
+    sprintf(path, "%s/iio:device0/%s", root, file);
+    f = fopen(path, "r");
+    if (f != NULL) {
+        if (fgets(value, sizeof value, f) == NULL) {
+            value[0] = 0;
+        }
+        fclose(f);
+    }
+
+    if (strcmp(value, expect)) {
+        fprintf(stderr, "%s: '%s', expected '%s'\n", file, value, expect);
+        return 1;
+    }
+
+    return 0;
+}
+
+static void writer(const char *fifo) {
+    uint8_t buf[SCANS * SCAN_SIZE], *scan;
+    int16_t v[7];
+    uint64_t ts;
+    uint32_t k, i, off;
+    int fd;
+
+    memset(buf, 0, sizeof buf);
+
+    for (k=0; k<SCANS; k++) {
+        scan = buf + k * SCAN_SIZE;
+        v[0] = 16384;  /* 1 g */
+        v[1] = -16384;
+        v[2] = k;
+        v[3] = -1000; /* 33.5 deg C */
+        v[4] = 1310;  /* 10 deg/s */
+        v[5] = -1310;
+        v[6] = 0;
+        for (i=0; i<7; i++) {
+            scan[2*i] = (uint16_t)v[i] >> 8;
+            scan[2*i+1] = (uint16_t)v[i] & 0xFF;
+        }
+        ts = 1000000 + k;
+        for (i=0; i<8; i++) {
+            scan[16+i] = (ts >> (8 * i)) & 0xFF;
+        }
+    }
+
+    fd = open(fifo, O_WRONLY);
+    if (fd < 0) {
+        return;
+    }
+
+    for (off=0; off<sizeof buf; off+=CHUNK) {
+        if (write(fd, buf + off, sizeof buf - off < CHUNK ? sizeof buf - off : CHUNK) < 0) {
+            break;
+        }
+    }
+
+    close(fd);
+}
+
+static void check(const struct mpu6050_sample *s, uint32_t k) {
+    if (s->data.acc.x != 1000 || s->data.acc.y != -1000
+        || s->data.acc.z != (int16_t)(k * 1000.0 / 16384)
+        || s->data.temp != 335
+        || s->data.gyro.x != 100 || s->data.gyro.y != -100 || s->data.gyro.z != 0
+        || s->timestamp != 1000000 + k) {
+        fprintf(stderr, "scan %lu: acc %d %d %d temp %d gyro %d %d %d ts %lu\n",
+            (unsigned long)k, s->data.acc.x, s->data.acc.y, s->data.acc.z, s->data.temp,
+            s->data.gyro.x, s->data.gyro.y, s->data.gyro.z, (unsigned long)s->timestamp);
+        failures++;
+    }
+}
+
+static void cleanup(void) {
+    char path[160];
+    uint32_t i;
+
+    for (i=0; i<IIO_NUM_CHANNELS; i++) {
+        sprintf(path, "%s/iio:device0/scan_elements/in_%s_index", root, channels[i]);
+        remove(path);
+        sprintf(path, "%s/iio:device0/scan_elements/in_%s_type", root, channels[i]);
+        remove(path);
+        sprintf(path, "%s/iio:device0/scan_elements/in_%s_en", root, channels[i]);
+        remove(path);
+    }
+
+    sprintf(path, "%s/iio:device0/scan_elements", root);
+    remove(path);
+    sprintf(path, "%s/iio:device0/buffer/enable", root);
+    remove(path);
+    sprintf(path, "%s/iio:device0/buffer/length", root);
+    remove(path);
+    sprintf(path, "%s/iio:device0/buffer", root);
+    remove(path);
+    sprintf(path, "%s/iio:device0/sampling_frequency", root);
+    remove(path);
+    sprintf(path, "%s/iio:device0/in_accel_scale", root);
+    remove(path);
+    sprintf(path, "%s/iio:device0/in_anglvel_scale", root);
+    remove(path);
+    sprintf(path, "%s/iio:device0/in_temp_scale", root);
+    remove(path);
+    sprintf(path, "%s/iio:device0/in_temp_offset", root);
+    remove(path);
+    sprintf(path, "%s/iio:device0", root);
+    remove(path);
+    sprintf(path, "%s/chrdev", root);
+    remove(path);
+    remove(root);
+}
@@ -0,0 +1,115 @@
+/*
+ * This file is part of mpu6050.
+ *
+ * Copyright (C) 2025 William Clark
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+
+/*
+
+Feeds known signals through spectrum_push() and checks the report.
+
+acc x carries a DC offset plus a sine centred on a bin, so the peak
+bin, its amplitude, the band mean square (A^2 / 2 in the band holding
+the sine, ~0 elsewhere) and the RMS are all known. acc y carries a sine
+at nyquist, whose amplitude must not be doubled, and gyro x is silent.
+Also checks that invalid bands are rejected.
+
+*/
+
+#include <stdio.h>
+#include <math.h>
+
+#include "spectrum.h"
+
+#define RATE   1000
+#define N      256
+#define BIN    32 /* 125 Hz */
+#define AMP    500.0
+#define DC     100.0
+#define NYQ    200.0
+#define PI 3.14159265358979323846
+
+static int failures;
+
+static void expect(const char *what, double value, double expect, double tol);
+
+int main(void) {
+    static spectrum_t sp;
+    struct spectrum_config cfg;
+    struct spectrum_report report;
+    struct mpu6050_data data;
+    uint32_t k;
+
+    cfg.n = N;
+    cfg.hop = N / 2;
+    cfg.report = 4;
+    cfg.rate = RATE;
+    cfg.bands = 2;
+    cfg.band[0].lo = 100; cfg.band[0].hi = 150;
+    cfg.band[1].lo = 300; cfg.band[1].hi = 400;
+
+    if (spectrum_init(&sp, &cfg)) {
+        fprintf(stderr, "spectrum_init() failed\n");
+        return 1;
+    }
+
+    for (k=0; ; k++) {
+        data.acc.x = floor(DC + AMP * sin(2 * PI * BIN * k / N) + 0.5);
+        data.acc.y = k & 1 ? -NYQ : NYQ;
+        data.acc.z = 0;
+        data.gyro.x = 0;
+        data.gyro.y = 0;
+        data.gyro.z = 0;
+        if (spectrum_push(&sp, &data, &report)) {
+            break;
+        }
+    }
+
+    expect("acc x peak freq", report.ch[SPECTRUM_ACC_X].peak_freq, BIN * (double)RATE / N, 1e-3);
+    expect("acc x peak amp", report.ch[SPECTRUM_ACC_X].peak_amp, AMP, 0.01 * AMP);
+    expect("acc x band 0", report.ch[SPECTRUM_ACC_X].band[0], AMP * AMP / 2, 0.01 * AMP * AMP / 2);
+    expect("acc x band 1", report.ch[SPECTRUM_ACC_X].band[1], 0, 1);
+    expect("acc x rms", report.ch[SPECTRUM_ACC_X].rms, AMP / sqrt(2), 0.01 * AMP);
+    expect("acc y peak freq", report.ch[SPECTRUM_ACC_Y].peak_freq, RATE / 2, 1e-3);
+    expect("acc y peak amp", report.ch[SPECTRUM_ACC_Y].peak_amp, NYQ, 0.01 * NYQ);
+    expect("acc y rms", report.ch[SPECTRUM_ACC_Y].rms, NYQ, 0.01 * NYQ);
+    expect("gyro x rms", report.ch[SPECTRUM_GYRO_X].rms, 0, 1e-6);
+    expect("gyro x peak amp", report.ch[SPECTRUM_GYRO_X].peak_amp, 0, 1e-6);
+
+    cfg.band[1].lo = -1;
+    if (!spectrum_init(&sp, &cfg)) {
+        fprintf(stderr, "negative band accepted\n");
+        failures++;
+    }
+
+    cfg.band[1].lo = 400; cfg.band[1].hi = 300;
+    if (!spectrum_init(&sp, &cfg)) {
+        fprintf(stderr, "inverted band accepted\n");
+        failures++;
+    }
+
+    printf("spectrum_test: %s\n", failures ? "FAIL" : "ok");
+
+    return failures != 0;
+}
+
+static void expect(const char *what, double value, double expect, double tol) {
+    if (fabs(value - expect) > tol) {
+        fprintf(stderr, "%s: %g, expected %g\n", what, value, expect);
+        failures++;
+    }
+}
@@ -0,0 +1,253 @@
+/*
+ * This file is part of mpu6050.
+ *
+ * Copyright (C) 2025 William Clark
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+
+/*
+
+Allan deviation of a recording or of a simulated device.
+
+usage: allan [-r rate] [-i interval] file
+       allan [-r rate] [-i interval] -s seconds
+
+A recording has one sample per line, "acc.x acc.y acc.z gyro.x gyro.y
+gyro.z" in driver units (mg and 0.1 deg / s), "-" reads stdin. The
+simulated device is read through mpu6050_read() and has the datasheet
+noise densities of the MPU-6050 plus a slow bias random walk, so its
+random walk figures should come out near 0.30 deg/sqrt(h) and
+0.24 m/s/sqrt(h).
+
+A summary is printed every interval seconds (default 60) and the full
+curve at the end.
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "allan.h"
+#include "mpu6050.h"
+#include "registers.h"
+
+#define PI 3.14159265358979323846
+#define SIM_GYRO_NOISE 0.005 /* deg/s/sqrt(Hz) */
+#define SIM_ACC_NOISE  0.4 /* mg/sqrt(Hz) */
+#define SIM_GYRO_WALK  0.0002 /* deg/s/sqrt(s) bias random walk */
+#define SIM_ACC_WALK   0.02 /* mg/sqrt(s) bias random walk */
+
+static const char *axis_names[ALLAN_AXES] = {
+    "acc x", "acc y", "acc z", "gyro x", "gyro y", "gyro z"
+};
+
+static double sim_rate;
+static double sim_bias[ALLAN_AXES];
+
+static double gauss(void);
+static int sim_read(uint8_t reg, uint8_t *dst, uint32_t size);
+static int sim_write(uint8_t reg, uint8_t value);
+static int sim_sleep(uint32_t dur_us);
+static void print_summary(const struct allan_snapshot *s, double rate);
+static void print_curve(const struct allan_snapshot *s);
+
+int main(int argc, char **argv) {
+    mpu6050_t mpu6050;
+    allan_t allan;
+    struct allan_snapshot snapshot;
+    FILE *f = NULL;
+    double rate = 1000, interval = 60, seconds = 0;
+    uint64_t n, total;
+    int i, ax, ay, az, gx, gy, gz;
+
+    for (i=1; i<argc-1 && argv[i][0] == '-' && argv[i][1]; i+=2) {
+        if (!strcmp(argv[i], "-r")) {
+            rate = atof(argv[i+1]);
+        } else if (!strcmp(argv[i], "-i")) {
+            interval = atof(argv[i+1]);
+        } else if (!strcmp(argv[i], "-s")) {
+            seconds = atof(argv[i+1]);
+        } else {
+            break;
+        }
+    }
+
+    /* a summary interval shorter than one sample would be 0 samples, */
+    /* and all that may follow the options is the file name */
+    if (rate <= 0 || interval * rate < 1
+        || (i < argc && argv[i][0] == '-' && argv[i][1])
+        || i != (seconds > 0 ? argc : argc - 1)) {
+        fprintf(stderr, "usage: %s [-r rate] [-i interval] file\n", argv[0]);
+        fprintf(stderr, "       %s [-r rate] [-i interval] -s seconds\n", argv[0]);
+        return 1;
+    }
+
+    allan_init(&allan, rate, (uint64_t)(interval * rate));
+
+    if (seconds > 0) {
+        sim_rate = rate;
+        mpu6050.dev.init = NULL;
+        mpu6050.dev.deinit = NULL;
+        mpu6050.dev.read = sim_read;
+        mpu6050.dev.write = sim_write;
+        mpu6050.dev.sleep = sim_sleep;
+
+        if (mpu6050_init(&mpu6050)) {
+            return 1;
+        }
+
+        mpu6050.cfg.gyro = MPU6050_GYRO_FS_250;
+        mpu6050.cfg.acc = MPU6050_ACC_FS_2G;
+
+        if (mpu6050_configure(&mpu6050)) {
+            return 1;
+        }
+
+        total = seconds * rate;
+        for (n=0; n<total; n++) {
+            if (mpu6050_read(&mpu6050)) {
+                return 1;
+            }
+            if (allan_push(&allan, &mpu6050.data, &snapshot)) {
+                print_summary(&snapshot, rate);
+            }
+        }
+    } else {
+        f = strcmp(argv[argc-1], "-") ? fopen(argv[argc-1], "r") : stdin;
+        if (f == NULL) {
+            fprintf(stderr, "could not open %s\n", argv[argc-1]);
+            return 1;
+        }
+
+        while (fscanf(f, "%d %d %d %d %d %d", &ax, &ay, &az, &gx, &gy, &gz) == 6) {
+            mpu6050.data.acc.x = ax;
+            mpu6050.data.acc.y = ay;
+            mpu6050.data.acc.z = az;
+            mpu6050.data.gyro.x = gx;
+            mpu6050.data.gyro.y = gy;
+            mpu6050.data.gyro.z = gz;
+            if (allan_push(&allan, &mpu6050.data, &snapshot)) {
+                print_summary(&snapshot, rate);
+            }
+        }
+
+        if (f != stdin) {
+            fclose(f);
+        }
+    }
+
+    /* the last periodic summary may already cover every sample */
+    if (!allan.samples || !allan.interval || allan.samples % allan.interval) {
+        allan_snapshot(&allan, &snapshot);
+        print_summary(&snapshot, rate);
+    }
+    print_curve(&snapshot);
+
+    return 0;
+}
+
+/* standard normal, Box-Muller */
+static double gauss(void) {
+    double u = (rand() + 1.0) / (RAND_MAX + 2.0);
+    double v = (rand() + 1.0) / (RAND_MAX + 2.0);
+
+    return sqrt(-2 * log(u)) * cos(2 * PI * v);
+}
+
+/* raw samples are encoded so mpu6050_decode() returns the simulated */
+/* value in driver units at the 2 g / 250 deg/s full-scale ranges */
+static int sim_read(uint8_t reg, uint8_t *dst, uint32_t size) {
+    double v;
+    int16_t raw;
+    int i;
+
+    memset(dst, 0, size);
+
+    switch (reg) {
+        case REG_WHO_AM_I:
+            dst[0] = 0x68;
+            break;
+        case REG_INT_STATUS:
+            dst[0] = 1;
+            break;
+        case REG_ACCEL_XOUT_H:
+            for (i=0; i<ALLAN_AXES; i++) {
+                if (i < ALLAN_GYRO_X) {
+                    sim_bias[i] += SIM_ACC_WALK * gauss() / sqrt(sim_rate);
+                    v = sim_bias[i] + SIM_ACC_NOISE * sqrt(sim_rate) * gauss();
+                    v += i == ALLAN_ACC_Z ? 1000 : 0; /* mg */
+                } else {
+                    sim_bias[i] += SIM_GYRO_WALK * gauss() / sqrt(sim_rate);
+                    v = (sim_bias[i] + SIM_GYRO_NOISE * sqrt(sim_rate) * gauss()) * 10;
+                }
+
+                raw = floor(v + 0.5) * 16;
+                /* gyro starts after the two temperature bytes */
+                dst[2*i + (i < ALLAN_GYRO_X ? 0 : 2)] = (uint16_t)raw >> 8;
+                dst[2*i + (i < ALLAN_GYRO_X ? 1 : 3)] = (uint16_t)raw & 0xFF;
+            }
+            break;
+    }
+
+    return 0;
+}
+
+static int sim_write(uint8_t reg, uint8_t value) {
+    (void)reg;
+    (void)value;
+
+    return 0;
+}
+
+static int sim_sleep(uint32_t dur_us) {
+    (void)dur_us;
+
+    return 0;
+}
+
+static void print_summary(const struct allan_snapshot *s, double rate) {
+    int a;
+
+    printf("t=%.0f s\n", s->samples / rate);
+    for (a=0; a<ALLAN_AXES; a++) {
+        printf("  %-6s random walk %9.4f %-11s bias instability %9.4f %-4s at %.3f s\n",
+            axis_names[a], s->axis[a].random_walk,
+            a < ALLAN_GYRO_X ? "m/s/sqrt(h)" : "deg/sqrt(h)",
+            s->axis[a].bias, a < ALLAN_GYRO_X ? "mg" : "deg/h",
+            s->axis[a].tau_bias);
+    }
+}
+
+static void print_curve(const struct allan_snapshot *s) {
+    uint32_t k;
+    int a;
+
+    printf("%12s", "tau [s]");
+    for (a=0; a<ALLAN_AXES; a++) {
+        printf(" %12s", axis_names[a]);
+    }
+    printf(" %10s\n", "clusters");
+
+    for (k=0; k<s->points; k++) {
+        printf("%12.4f", s->curve[0][k].tau);
+        for (a=0; a<ALLAN_AXES; a++) {
+            printf(" %12.6g", s->curve[a][k].adev);
+        }
+        printf(" %10lu\n", (unsigned long)s->curve[0][k].count + 1);
+    }
+}
@@ -0,0 +1,190 @@
+/*
+ * This file is part of mpu6050.
+ *
+ * Copyright (C) 2025 William Clark
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+
+/*
+
+Merges the streams of simulated devices sharing an FSYNC pulse.
+
+usage: merge_sim [seconds]
+
+DEVICES simulated devices sample the same instants at 1 kHz but stamp
+them with their own clocks, offset by 0, 5.3 and 7.1 ms and drifting by
+0, +100 and -100 ppm, plus up to 20 us of jitter. FSYNC goes high for
+two samples every 100 ms, latched into TEMP_OUT_L. Every sample carries
+its sample index in acc.x, so a frame is aligned if all its samples
+agree. Exits non-zero if any frame after the first realignment is not.
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "merge.h"
+#include "mpu6050.h"
+#include "registers.h"
+
+#define DEVICES 3
+#define RATE    1000
+#define BATCH   32
+#define WINDOW  200000 /* ns */
+#define EDGE_TOL 20000000 /* ns */
+
+static const double clock_offset[DEVICES] = { 0, 5.3e6, 7.1e6 }; /* ns */
+static const double clock_drift[DEVICES] = { 0, 100e-6, -100e-6 };
+
+static uint32_t sim_dev; /* device the next sim_read() is for */
+static uint32_t sim_k[DEVICES]; /* next sample index of each device */
+
+static int sim_read(uint8_t reg, uint8_t *dst, uint32_t size);
+static int sim_write(uint8_t reg, uint8_t value);
+static int sim_sleep(uint32_t dur_us);
+
+int main(int argc, char **argv) {
+    static struct mpu6050_sample buf[DEVICES][BATCH];
+    static struct merge_frame frames[BATCH];
+    mpu6050_t mpu6050[DEVICES];
+    merge_t merge;
+    uint32_t total, len, n, i, d, bad = 0, checked = 0;
+    uint64_t t;
+    int seconds = argc > 1 ? atoi(argv[1]) : 10;
+
+    if (seconds <= 0) {
+        fprintf(stderr, "usage: %s [seconds]\n", argv[0]);
+        return 1;
+    }
+
+    total = seconds * RATE;
+
+    for (d=0; d<DEVICES; d++) {
+        mpu6050[d].dev.init = NULL;
+        mpu6050[d].dev.deinit = NULL;
+        mpu6050[d].dev.read = sim_read;
+        mpu6050[d].dev.write = sim_write;
+        mpu6050[d].dev.sleep = sim_sleep;
+
+        sim_dev = d;
+        if (mpu6050_init(&mpu6050[d])) {
+            return 1;
+        }
+
+        mpu6050[d].cfg.acc = MPU6050_ACC_FS_2G;
+        mpu6050[d].cfg.ext_sync = MPU6050_EXT_SYNC_TEMP_OUT_L;
+
+        if (mpu6050_configure(&mpu6050[d])) {
+            return 1;
+        }
+    }
+
+    merge_init(&merge, DEVICES, WINDOW, EDGE_TOL);
+
+    while (sim_k[0] < total || merge.heap_size == DEVICES) {
+        /* refill every consumed stream, in batches of different sizes */
+        for (d=0; d<DEVICES; d++) {
+            if (merge.stream[d].pos < merge.stream[d].len || sim_k[d] >= total) {
+                continue;
+            }
+
+            len = BATCH - 7 * d;
+            if (len > total - sim_k[d]) {
+                len = total - sim_k[d];
+            }
+
+            sim_dev = d;
+            for (i=0; i<len; i++) {
+                t = clock_offset[d] + sim_k[d] * (1e9 / RATE) * (1 + clock_drift[d]) + rand() % 20000;
+                if (mpu6050_read_sample(&mpu6050[d], t, &buf[d][i])) {
+                    return 1;
+                }
+            }
+
+            merge_feed(&merge, d, buf[d], len);
+        }
+
+        n = merge_run(&merge, frames, BATCH);
+        for (i=0; i<n; i++) {
+            if (!merge.stats.edges) {
+                continue;
+            }
+            checked++;
+            for (d=1; d<DEVICES; d++) {
+                if (frames[i].sample[d].data.acc.x != frames[i].sample[0].data.acc.x) {
+                    bad++;
+                    break;
+                }
+            }
+        }
+
+        if (!n && sim_k[0] >= total) {
+            break;
+        }
+    }
+
+    printf("%lu samples per device, %lu frames, %lu checked, %lu misaligned\n",
+        (unsigned long)total, (unsigned long)merge.stats.frames,
+        (unsigned long)checked, (unsigned long)bad);
+    printf("dropped %lu, edges %lu, skew max %lu ns, mean %lu ns\n",
+        (unsigned long)merge.stats.dropped, (unsigned long)merge.stats.edges,
+        (unsigned long)merge.stats.skew_max,
+        (unsigned long)(merge.stats.frames ? merge.stats.skew_sum / merge.stats.frames : 0));
+
+    return bad != 0 || !checked;
+}
+
+/* raw samples are encoded so mpu6050_decode() returns the sample index */
+/* in acc.x at the 2 g full-scale range */
+static int sim_read(uint8_t reg, uint8_t *dst, uint32_t size) {
+    uint32_t k;
+    uint16_t raw;
+
+    memset(dst, 0, size);
+
+    switch (reg) {
+        case REG_WHO_AM_I:
+            dst[0] = 0x68;
+            break;
+        case REG_INT_STATUS:
+            dst[0] = 1;
+            break;
+        case REG_ACCEL_XOUT_H:
+            k = sim_k[sim_dev]++;
+            raw = (k % 2048) << 4;
+            dst[0] = raw >> 8;
+            dst[1] = raw & 0xFF;
+            /* FSYNC latched into the lsb of TEMP_OUT_L */
+            dst[7] = (k % 100) < 2;
+            break;
+    }
+
+    return 0;
+}
+
+static int sim_write(uint8_t reg, uint8_t value) {
+    (void)reg;
+    (void)value;
+
+    return 0;
+}
+
+static int sim_sleep(uint32_t dur_us) {
+    (void)dur_us;
+
+    return 0;
+}
@@ -0,0 +1,117 @@
+/*
+ * This file is part of mpu6050.
+ *
+ * Copyright (C) 2025 William Clark
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+
+/*
+
+Measures how many channels sampled at 1 kHz one core can analyse.
+
+usage: spectrum_bench [instances] [seconds]
+
+Each instance analyses the 6 channels of one device, fed with a 120 Hz
+sine on acc x plus noise. n = 1024, 50% overlap, one report per second.
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+
+#include "spectrum.h"
+
+#define RATE 1000
+#define PI 3.14159265358979323846
+
+int main(int argc, char **argv) {
+    struct spectrum_config cfg;
+    struct spectrum_report report;
+    struct mpu6050_data *data;
+    spectrum_t *sp;
+    int instances = argc > 1 ? atoi(argv[1]) : 16;
+    int seconds = argc > 2 ? atoi(argv[2]) : 60;
+    int i, j, t, reports = 0;
+    clock_t start;
+    double cpu, channels;
+
+    if (instances <= 0 || seconds <= 0) {
+        fprintf(stderr, "usage: %s [instances] [seconds]\n", argv[0]);
+        return 1;
+    }
+
+    cfg.n = 1024;
+    cfg.hop = 512;
+    cfg.report = 2;
+    cfg.rate = RATE;
+    cfg.bands = 3;
+    cfg.band[0].lo = 10;  cfg.band[0].hi = 100;
+    cfg.band[1].lo = 100; cfg.band[1].hi = 200;
+    cfg.band[2].lo = 200; cfg.band[2].hi = 500;
+
+    sp = malloc(instances * sizeof *sp);
+    data = malloc(RATE * sizeof *data);
+    if (sp == NULL || data == NULL) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+
+    for (i=0; i<instances; i++) {
+        if (spectrum_init(&sp[i], &cfg)) {
+            fprintf(stderr, "spectrum_init() failed\n");
+            return 1;
+        }
+    }
+
+    /* one second of data, replayed to every instance */
+    for (t=0; t<RATE; t++) {
+        data[t].acc.x = 250 * sin(2 * PI * 120 * t / RATE) + rand() % 21 - 10;
+        data[t].acc.y = rand() % 21 - 10;
+        data[t].acc.z = 1000 + rand() % 21 - 10;
+        data[t].gyro.x = rand() % 11 - 5;
+        data[t].gyro.y = rand() % 11 - 5;
+        data[t].gyro.z = rand() % 11 - 5;
+        data[t].temp = 250;
+        data[t].fsync = 0;
+    }
+
+    start = clock();
+    for (j=0; j<seconds; j++) {
+        for (i=0; i<instances; i++) {
+            for (t=0; t<RATE; t++) {
+                reports += spectrum_push(&sp[i], &data[t], &report);
+            }
+        }
+    }
+    cpu = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+    printf("acc x: rms %.1f mg, peak %.1f mg at %.1f Hz, bands %.1f %.1f %.1f mg^2\n",
+        report.ch[SPECTRUM_ACC_X].rms, report.ch[SPECTRUM_ACC_X].peak_amp,
+        report.ch[SPECTRUM_ACC_X].peak_freq, report.ch[SPECTRUM_ACC_X].band[0],
+        report.ch[SPECTRUM_ACC_X].band[1], report.ch[SPECTRUM_ACC_X].band[2]);
+
+    channels = (double)instances * SPECTRUM_CHANNELS * seconds / (cpu > 0 ? cpu : 1e-9);
+    printf("%d channels, %d s at %d Hz, %d reports in %.3f s cpu\n",
+        instances * SPECTRUM_CHANNELS, seconds, RATE, reports, cpu);
+    printf("~%.0f channels at %d Hz per core\n", channels, RATE);
+
+    free(sp);
+    free(data);
+
+    return 0;
+}